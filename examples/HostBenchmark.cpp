@@ -0,0 +1,259 @@
+// Measures the CPU cost of the manager per device on a Linux host against simulated buses.
+// Build: pio run -e native_benchmark && .pio/build/native_benchmark/program
+//
+// The simulated bus has its own cost (the ROM search of the simulator is quadratic), so the same bus
+// operations are run once more without the manager and subtracted: what is left is the manager overhead,
+// which should stay flat per device when the number of devices grows. The bus columns are the simulated
+// time on the wire, the allocs column counts the heap allocations of the scans and polls.
+//
+// Then the hot calls are timed one by one in ns/op: the lookups, the address codec and the event post.
+//
+// At the end the heap is checked: after Init() polling, renames and device loss/restore must not allocate.
+// The program fails (exit code 1) if they do, or if the lost devices are not restored.
+#include <Arduino.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include "Async1WireMgr.hpp"
+#include "OneWireBusSim.hpp"
+#include "DS18x20.hpp"
+
+#define BENCH_BUSES 4
+#define BENCH_FIRST_PIN 10
+#define BENCH_REPEATS 5 // the best of the repeats is taken
+#define BENCH_POLL_INTERVAL (60 * 1000) // longer than a cycle of the largest setup: one cycle per RunFor()
+
+static OneWireBusSim buses[BENCH_BUSES];
+static unsigned long allocations = 0;
+
+void *operator new(size_t size)
+{
+    allocations++;
+    void *p = malloc(size);
+    if (p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
+static volatile uint32_t sink; // keeps the results of the timed calls
+
+static double nowMicros()
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint64_t busMicros()
+{
+    uint64_t total = 0;
+    for (int b = 0; b < BENCH_BUSES; b++)
+    {
+        total += buses[b].GetBusMicros();
+    }
+    return total;
+}
+
+static void temperatureHandler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    sink += (uint32_t)((TemperatureEvent *)event_data)->Temperature;
+}
+
+// the best of the repeats of ops calls, in ns per call
+template <typename F>
+static void benchOp(const char *name, int ops, F op)
+{
+    double best = 1e12;
+    unsigned long allocs = 0;
+    for (int r = 0; r < BENCH_REPEATS; r++)
+    {
+        unsigned long before = allocations;
+        double start = nowMicros();
+        for (int i = 0; i < ops; i++)
+        {
+            op(i);
+        }
+        best = std::min(best, nowMicros() - start);
+        allocs = allocations - before;
+    }
+    Serial.printf("%-28s %12.1f %12.2f\n", name, best * 1000 / ops, (double)allocs / ops);
+}
+
+// bus operations of SearchDevices() without the manager
+static void rawSearch()
+{
+    uint8_t rom[8];
+    uint8_t scratchPad[DS18X20_SCRATCHPAD_SIZE];
+    for (int b = 0; b < BENCH_BUSES; b++)
+    {
+        OneWireBus *bus = &buses[b];
+        bus->reset_search();
+        std::vector<Address1Wire> found;
+        Address1Wire addr;
+        while (bus->search(addr.addr))
+        {
+            found.push_back(addr);
+        }
+        DS18x20::ReadPowerSupply(bus, nullptr);
+        for (auto &a : found)
+        {
+            memcpy(rom, a.addr, sizeof(rom));
+            DS18x20::ReadPowerSupply(bus, rom);
+            DS18x20::IsConnected(bus, rom, scratchPad);
+        }
+    }
+}
+
+// bus operations of one poll cycle without the manager
+static void rawPoll()
+{
+    uint8_t rom[8];
+    uint8_t scratchPad[DS18X20_SCRATCHPAD_SIZE];
+    for (int b = 0; b < BENCH_BUSES; b++)
+    {
+        DS18x20::StartConversion(&buses[b], nullptr, false);
+        HostPlatform::Advance(DS18x20::ConversionTimeMicros(DEFAULT_RESOLUTION));
+        for (int d = 0; d < buses[b].GetNumbDevices(); d++)
+        {
+            buses[b].GetRom(d, rom);
+            DS18x20::ReadCheckedScratchPad(&buses[b], rom, scratchPad);
+        }
+    }
+}
+
+int main()
+{
+    const int sizes[] = {1, 10, 125, 250, 500, 1000, 2000};
+    for (int b = 0; b < BENCH_BUSES; b++)
+    {
+        OneWireMgr.Add1Wire(BENCH_FIRST_PIN + b, &buses[b]);
+    }
+    OneWireMgr.SetTemperatureTimerInterval(BENCH_POLL_INTERVAL);
+    OneWireMgr.Init();
+
+    esp_event_handler_instance_register(ONEWIRE_EVENT, ONEWIRE_EVENT_TEMPERATURE, temperatureHandler, NULL, NULL);
+    Serial.printf("%8s %12s %10s %14s %12s %10s %14s %8s\n", "devices", "scan us/dev", "overhead", "scan bus us/dev",
+                  "poll us/dev", "overhead", "poll bus us/dev", "allocs");
+    int devices = 0;
+    for (int size : sizes)
+    {
+        while (devices < size)
+        {
+            int d = buses[devices % BENCH_BUSES].AddDevice(DS18B20MODEL, devices + 1);
+            buses[devices % BENCH_BUSES].SetTemperature(d, 20.0f + (devices % 100) * 0.1f);
+            devices++;
+        }
+        // the first search adds the new devices, the second one is the steady state rescan
+        OneWireMgr.SearchDevices();
+
+        double scan = 1e12, rawScan = 1e12, poll = 1e12, rawPolling = 1e12;
+        uint64_t scanBus = 0, pollBus = 0;
+        unsigned long allocs = 0;
+        for (int r = 0; r < BENCH_REPEATS; r++)
+        {
+            uint64_t bus = busMicros();
+            unsigned long before = allocations;
+            double start = nowMicros();
+            OneWireMgr.SearchDevices();
+            scan = std::min(scan, nowMicros() - start);
+            allocs += allocations - before;
+            scanBus = busMicros() - bus;
+            start = nowMicros();
+            rawSearch();
+            rawScan = std::min(rawScan, nowMicros() - start);
+        }
+        // the searches have moved the clock: let the timers catch up, then each run has one cycle
+        HostPlatform::RunFor(BENCH_POLL_INTERVAL);
+        for (int r = 0; r < BENCH_REPEATS; r++)
+        {
+            uint64_t bus = busMicros();
+            unsigned long before = allocations;
+            double start = nowMicros();
+            HostPlatform::RunFor(BENCH_POLL_INTERVAL);
+            poll = std::min(poll, nowMicros() - start);
+            allocs += allocations - before;
+            pollBus = busMicros() - bus;
+            start = nowMicros();
+            rawPoll();
+            rawPolling = std::min(rawPolling, nowMicros() - start);
+        }
+        double scanOverhead = scan - rawScan;
+        double pollOverhead = poll - rawPolling;
+
+        Serial.printf("%8d %12.2f %10.2f %14.0f %12.2f %10.2f %14.0f %8lu\n", devices, scan / devices,
+                      scanOverhead / devices, (double)scanBus / devices, poll / devices, pollOverhead / devices,
+                      (double)pollBus / devices, allocs);
+    }
+
+    Serial.printf("\n%-28s %12s %12s\n", "operation", "ns/op", "allocs/op");
+    ThermometerHandle count = (ThermometerHandle)OneWireMgr.GetNumbThermometers();
+    benchOp("GetThermometer", 1000000, [&](int i) { sink += OneWireMgr.GetThermometer(i % count)->Pin; });
+    ThermometerSnapshot snapshot;
+    benchOp("GetSnapshot", 1000000, [&](int i) {
+        OneWireMgr.GetSnapshot(i % count, snapshot);
+        sink += snapshot.Pin;
+    });
+    char names[64][LENGTH_OF_NAME];
+    char printed[64][SIZE_OF_ADDRESS_PRINTED + 1];
+    for (int i = 0; i < 64; i++)
+    {
+        const Thermometer *t = OneWireMgr.GetThermometer(i * count / 64);
+        strncpy(names[i], t->Name, LENGTH_OF_NAME);
+        strncpy(printed[i], Async1WireMgr::PrintAddress(t->Address), sizeof(printed[i]));
+    }
+    benchOp("FindThermometer", 1000000, [&](int i) { sink += OneWireMgr.FindThermometer(names[i & 63]); });
+    benchOp("ParseAddress", 1000000,
+            [&](int i) { sink += (uint32_t)Async1WireMgr::ParseAddress(printed[i & 63]).packedAddress; });
+    benchOp("PrintAddress", 1000000, [&](int i) {
+        sink += Async1WireMgr::PrintAddress(OneWireMgr.GetThermometer(i % count)->Address)[0];
+    });
+    TemperatureEvent event;
+    strncpy(event.Name, names[0], sizeof(event.Name));
+    event.Temperature = 21.5;
+    benchOp("esp_event_post (1 handler)", 1000000, [&](int i) {
+        esp_event_post(ONEWIRE_EVENT, ONEWIRE_EVENT_TEMPERATURE, &event, sizeof(event), portMAX_DELAY);
+    });
+
+    // heap check: polling, renames, device loss and restore
+    uint32_t restoredBefore[BENCH_BUSES];
+    for (int b = 0; b < BENCH_BUSES; b++)
+    {
+        BusStats stats;
+        OneWireMgr.GetBusStats(BENCH_FIRST_PIN + b, stats);
+        restoredBefore[b] = stats.Restored;
+    }
+    unsigned long start = allocations;
+    HostPlatform::RunFor(BENCH_POLL_INTERVAL);
+    for (int i = 0; i < 10; i++)
+    {
+        Address1Wire addr;
+        char name[LENGTH_OF_NAME];
+        buses[i % BENCH_BUSES].GetRom(i / BENCH_BUSES, addr.addr);
+        snprintf(name, sizeof(name), "Renamed%d", i);
+        OneWireMgr.SetThermometerName(name, addr);
+        buses[i % BENCH_BUSES].SetConnected(i / BENCH_BUSES, false);
+    }
+    HostPlatform::RunFor(BENCH_POLL_INTERVAL);
+    for (int i = 0; i < 10; i++)
+    {
+        buses[i % BENCH_BUSES].SetConnected(i / BENCH_BUSES, true);
+    }
+    // a lost device is reprobed 2 poll intervals after its loss: until then it is not read
+    HostPlatform::RunFor(3 * BENCH_POLL_INTERVAL);
+    unsigned long heap = allocations - start;
+    uint32_t restored = 0;
+    for (int b = 0; b < BENCH_BUSES; b++)
+    {
+        BusStats stats;
+        OneWireMgr.GetBusStats(BENCH_FIRST_PIN + b, stats);
+        restored += stats.Restored - restoredBefore[b];
+    }
+    Serial.printf("Heap allocations after Init (poll, rename, loss, restore of %u devices): %lu\n", restored, heap);
+    return heap == 0 && restored == 10 ? 0 : 1;
+}
@@ -0,0 +1,104 @@
+// Thermometers, battery monitors and switches polled by the same bus cycles, on a Linux host.
+// Build: pio run -e native_families && .pio/build/native_families/program
+#include <Arduino.h>
+#include "Async1WireMgr.hpp"
+#include "OneWireBusSim.hpp"
+#include "FamilyDrivers.hpp"
+
+#define SIM_THERMOMETERS_PER_BUS 4
+
+static DS2438Driver batteryDriver;
+static DS2408Driver relaysDriver;
+static DS2413Driver doorDriver;
+static int temperatureEvents = 0;
+static int deviceEvents = 0;
+
+void temperatureHandler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    temperatureEvents++;
+}
+
+void deviceHandler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    DeviceEvent *device = (DeviceEvent *)event_data;
+    deviceEvents++;
+    if (strcmp(device->Name, "Door") == 0)
+    {
+        Serial.printf("Door %s at %lu ms\n", device->Values.Values[0] != 0 ? "closed" : "open", millis());
+    }
+}
+
+int main()
+{
+    esp_event_handler_instance_register(ONEWIRE_EVENT, ONEWIRE_EVENT_TEMPERATURE, temperatureHandler, NULL, NULL);
+    esp_event_handler_instance_register(ONEWIRE_EVENT, ONEWIRE_EVENT_DEVICE, deviceHandler, NULL, NULL);
+
+    // the same devices on both buses: bus 10 converts all families by one broadcast, bus 11 device by device
+    OneWireBusSim buses[2];
+    int battery = 0;
+    int relays = 0;
+    int door = 0;
+    for (int b = 0; b < 2; b++)
+    {
+        for (int i = 0; i < SIM_THERMOMETERS_PER_BUS; i++)
+        {
+            buses[b].SetTemperature(buses[b].AddDevice(DS18B20MODEL, b * 100 + i + 1), 20.0f + i);
+        }
+        battery = buses[b].AddDevice(DS2438MODEL, b * 100 + 10);
+        relays = buses[b].AddDevice(DS2408MODEL, b * 100 + 20);
+        door = buses[b].AddDevice(DS2413MODEL, b * 100 + 30);
+        buses[b].SetTemperature(battery, 31.5f);
+        buses[b].SetVoltage(battery, 4.2f);
+    }
+    OneWireMgr.RegisterDriver(DS2438MODEL, &batteryDriver);
+    OneWireMgr.RegisterDriver(DS2408MODEL, &relaysDriver);
+    OneWireMgr.RegisterDriver(DS2413MODEL, &doorDriver);
+    OneWireMgr.Add1Wire(10, &buses[0]);
+    OneWireMgr.Add1Wire(11, &buses[1]);
+    OneWireMgr.SetConversionMode(11, CONVERSION_PER_DEVICE);
+    OneWireMgr.SetTemperatureTimerInterval(5000);
+    OneWireMgr.Init();
+
+    Address1Wire addr;
+    buses[0].GetRom(battery, addr.addr);
+    OneWireMgr.SetThermometerName("Battery", addr);
+    buses[0].GetRom(relays, addr.addr);
+    OneWireMgr.SetThermometerName("Relays", addr);
+    buses[0].GetRom(door, addr.addr);
+    OneWireMgr.SetThermometerName("Door", addr);
+
+    // the battery discharges, a relay and the door change every 20 s
+    for (int s = 0; s < 60; s++)
+    {
+        for (int b = 0; b < 2; b++)
+        {
+            buses[b].SetVoltage(battery, 4.2f - s * 0.005f);
+            buses[b].SetPio(relays, s % 40 < 20 ? 0xFF : 0xFE);
+            buses[b].SetPio(door, s % 40 < 20 ? 0x03 : 0x02);
+        }
+        HostPlatform::RunFor(1000);
+    }
+
+    Serial.printf("%d devices of 4 families, 60 s: %d temperature events, %d device events\n",
+                  OneWireMgr.GetNumbThermometers(), temperatureEvents, deviceEvents);
+    for (int b = 0; b < 2; b++)
+    {
+        BusStats stats;
+        OneWireMgr.GetBusStats(10 + b, stats);
+        Serial.printf("Bus %d (%s): %u cycles, %u reads, cycle max %u us\n", 10 + b,
+                      b == 0 ? "one broadcast" : "per device", stats.Cycles, stats.Reads, stats.Cycle.Max);
+    }
+    const char *names[] = {"Battery", "Relays", "Door"};
+    for (int i = 0; i < 3; i++)
+    {
+        DeviceValues values;
+        OneWireMgr.GetDeviceValues(OneWireMgr.FindThermometer(names[i]), values);
+        Serial.printf("%s:", names[i]);
+        for (uint8_t v = 0; v < values.Count; v++)
+        {
+            Serial.printf(" %.2f", values.Values[v]);
+        }
+        Serial.printf("\n");
+    }
+    return 0;
+}
@@ -0,0 +1,82 @@
+// History of the reads with rolling aggregates on a Linux host.
+// Build: pio run -e native_history && .pio/build/native_history/program
+#include <Arduino.h>
+#include <math.h>
+#include "Async1WireMgr.hpp"
+#include "OneWireBusSim.hpp"
+#include "TemperatureHistory.hpp"
+#include "DS18x20.hpp"
+
+#define READ_INTERVAL 5000
+
+// 120 reads: 10 minutes at the read interval
+static TemperatureHistoryBuffer<120> boilerHistory;
+
+int main()
+{
+    OneWireBusSim bus;
+    int boiler = bus.AddDevice(DS18B20MODEL, 1);
+    bus.AddDevice(DS18B20MODEL, 2);
+    bus.SetTemperature(boiler, 60.0f);
+    OneWireMgr.Add1Wire(10, &bus);
+    OneWireMgr.Init();
+
+    Address1Wire addr;
+    bus.GetRom(boiler, addr.addr);
+    OneWireMgr.SetThermometerName("Boiler", addr);
+    ThermometerHandle h = OneWireMgr.FindThermometer("Boiler");
+    boilerHistory.SetWindow(0, 60 * 1000);
+    boilerHistory.SetWindow(1, 10 * 60 * 1000);
+    OneWireMgr.SetHistory(addr, &boilerHistory);
+    OneWireMgr.SetThermometerInterval(addr, READ_INTERVAL);
+
+    // the boiler swings 60 +- 5 degrees with a 4 minute period; the consumer wakes up every 2 minutes
+    uint32_t sequence = 0;
+    uint32_t gaps = 0;
+    uint32_t streamed = 0;
+    HistorySample samples[32];
+    for (int s = 0; s < 20 * 60; s++)
+    {
+        bus.SetTemperature(boiler, 60.0f + 5.0f * sinf(s * 2 * (float)M_PI / 240));
+        // the boiler sensor drops out for a minute
+        bus.SetConnected(boiler, s < 13 * 60 || s >= 14 * 60);
+        HostPlatform::RunFor(1000);
+        if (s % 120 == 119)
+        {
+            uint16_t count;
+            while ((count = OneWireMgr.ReadHistory(h, sequence, samples, 32)) > 0)
+            {
+                for (uint16_t i = 0; i < count; i++)
+                {
+                    gaps += samples[i].Sequence - sequence - 1;
+                    sequence = samples[i].Sequence;
+                }
+                streamed += count;
+            }
+        }
+    }
+
+    Serial.printf("20 min: %u samples streamed every 2 min, %u missed\n", streamed, gaps);
+    for (uint8_t w = 0; w < 2; w++)
+    {
+        HistoryAggregate aggregate;
+        OneWireMgr.GetHistoryAggregate(h, w, aggregate);
+        Serial.printf("Last %u s: %u reads, min %.2f, max %.2f, mean %.2f\n", aggregate.Window / 1000, aggregate.Count,
+                      aggregate.Min, aggregate.Max, aggregate.Mean);
+    }
+    // the whole ring: the reads of the last 10 minutes with the lost ones
+    uint16_t kept = 0;
+    uint16_t lost = 0;
+    uint16_t count;
+    for (sequence = 0; (count = OneWireMgr.ReadHistory(h, sequence, samples, 32)) > 0;)
+    {
+        for (uint16_t i = 0; i < count; i++)
+        {
+            lost += samples[i].Status == SAMPLE_LOST;
+        }
+        kept += count;
+        sequence = samples[count - 1].Sequence;
+    }
+    Serial.printf("%u samples kept, %u of them lost reads\n", kept, lost);
+    return 0;
+}
@@ -0,0 +1,75 @@
+// Two independent managers on a Linux host: the buses are split by cadence, each manager posts to its own loop.
+// Build: pio run -e native_partitions && .pio/build/native_partitions/program
+#include <Arduino.h>
+#include "Async1WireMgr.hpp"
+#include "OneWireBusSim.hpp"
+#include "DS18x20.hpp"
+
+#define SIM_BUSES_PER_MANAGER 4
+#define SIM_SENSORS_PER_BUS 10
+
+static esp_event_loop_handle_t fastLoop;
+static esp_event_loop_handle_t slowLoop;
+static int fastEvents = 0;
+static int slowEvents = 0;
+
+void temperatureHandler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    (*(int *)arg)++;
+}
+
+int main()
+{
+    esp_event_loop_args_t args = {16, "fast", 5, 4096, tskNO_AFFINITY};
+    esp_event_loop_create(&args, &fastLoop);
+    args.task_name = "slow";
+    esp_event_loop_create(&args, &slowLoop);
+    esp_event_handler_instance_register_with(fastLoop, ONEWIRE_EVENT, ONEWIRE_EVENT_TEMPERATURE, temperatureHandler,
+                                             &fastEvents, NULL);
+    esp_event_handler_instance_register_with(slowLoop, ONEWIRE_EVENT, ONEWIRE_EVENT_TEMPERATURE, temperatureHandler,
+                                             &slowEvents, NULL);
+
+    // process control buses every 2 s, room sensors every 60 s
+    static Async1WireMgr fast(fastLoop);
+    static Async1WireMgr slow(slowLoop);
+    static OneWireBusSim buses[2 * SIM_BUSES_PER_MANAGER];
+    for (int b = 0; b < 2 * SIM_BUSES_PER_MANAGER; b++)
+    {
+        for (int i = 0; i < SIM_SENSORS_PER_BUS; i++)
+        {
+            buses[b].AddDevice(DS18B20MODEL, b * 100 + i + 1);
+        }
+        (b < SIM_BUSES_PER_MANAGER ? fast : slow).Add1Wire(10 + b, &buses[b]);
+    }
+    fast.SetTemperatureTimerInterval(2000);
+    slow.SetTemperatureTimerInterval(60 * 1000);
+    fast.Init();
+    slow.Init();
+
+    // the sensors change every second: each reading is posted
+    for (int s = 0; s < 300; s++)
+    {
+        for (int b = 0; b < 2 * SIM_BUSES_PER_MANAGER; b++)
+        {
+            for (int i = 0; i < SIM_SENSORS_PER_BUS; i++)
+            {
+                buses[b].SetTemperature(i, 20.0f + (s % 7) * 0.5f);
+            }
+        }
+        HostPlatform::RunFor(1000);
+    }
+    for (int m = 0; m < 2; m++)
+    {
+        Async1WireMgr &manager = m == 0 ? fast : slow;
+        uint32_t cycles = 0;
+        for (int b = 0; b < SIM_BUSES_PER_MANAGER; b++)
+        {
+            BusStats stats;
+            manager.GetBusStats(10 + m * SIM_BUSES_PER_MANAGER + b, stats);
+            cycles += stats.Cycles;
+        }
+        Serial.printf("%s manager: %d thermometers, %u cycles, %d temperature events on its loop in 300 s\n",
+                      m == 0 ? "Fast" : "Slow", manager.GetNumbThermometers(), cycles, m == 0 ? fastEvents : slowEvents);
+    }
+    return 0;
+}
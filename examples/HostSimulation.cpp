@@ -0,0 +1,268 @@
+// Runs the manager on a Linux host against simulated buses.
+// Build: pio run -e native && .pio/build/native/program
+#include <Arduino.h>
+#include "Async1WireMgr.hpp"
+#include "OneWireBusSim.hpp"
+#include "DS18x20.hpp"
+
+#define SIM_BUSES 2
+#define SIM_SENSORS_PER_BUS 200
+
+static int thermometerEvents = 0;
+static int temperatureEvents = 0;
+static int crcErrorEvents = 0;
+static int batchEvents = 0;
+static int batchReadings = 0;
+static unsigned long addedAt = 0;
+static int lostEvents = 0;
+static int busEvents = 0;
+static unsigned long readDoneAt[4];
+
+void thermometerHandler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    ThermometerEvent *t = (ThermometerEvent *)event_data;
+    if (t->Event == UNIT_ERROR && t->ErrorCode == UNIT_CRC_ERROR)
+    {
+        crcErrorEvents++;
+    }
+    if (t->Event == UNIT_ADDED)
+    {
+        addedAt = millis();
+    }
+    if (t->Event == UNIT_CONNECTION_LOST)
+    {
+        lostEvents++;
+    }
+    thermometerEvents++;
+}
+
+void temperatureHandler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    temperatureEvents++;
+}
+
+void busHandler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    BusEvent *event = (BusEvent *)event_data;
+    Serial.printf("Bus %d %s at %lu ms\n", event->Pin, event->Event == BUS_SUSPENDED ? "suspended" : "resumed",
+                  millis());
+    busEvents++;
+}
+
+void readDone(const ReadResult &result, void *arg)
+{
+    readDoneAt[result.Token] = millis();
+}
+
+void temperatureBatchHandler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    TemperatureBatchEvent *batch = (TemperatureBatchEvent *)event_data;
+    batchEvents++;
+    batchReadings += batch->Count;
+}
+
+int main()
+{
+    esp_event_handler_instance_register(ONEWIRE_EVENT, ONEWIRE_EVENT_THERMOMETER, thermometerHandler, NULL, NULL);
+    esp_event_handler_instance_register(ONEWIRE_EVENT, ONEWIRE_EVENT_TEMPERATURE, temperatureHandler, NULL, NULL);
+    esp_event_handler_instance_register(ONEWIRE_EVENT, ONEWIRE_EVENT_TEMPERATURE_BATCH, temperatureBatchHandler, NULL,
+                                        NULL);
+    esp_event_handler_instance_register(ONEWIRE_EVENT, ONEWIRE_EVENT_BUS, busHandler, NULL, NULL);
+
+    OneWireBusSim buses[SIM_BUSES];
+    for (int b = 0; b < SIM_BUSES; b++)
+    {
+        for (int i = 0; i < SIM_SENSORS_PER_BUS; i++)
+        {
+            int d = buses[b].AddDevice(DS18B20MODEL, b * 1000 + i + 1);
+            buses[b].SetTemperature(d, 20.0f + i * 0.1f);
+        }
+        OneWireMgr.Add1Wire(10 + b, &buses[b]);
+    }
+
+    unsigned long start = millis();
+    OneWireMgr.Init();
+    Serial.printf("Init: %lu ms, %d thermometers, %d events\n", millis() - start, OneWireMgr.GetNumbThermometers(),
+                  thermometerEvents);
+
+    for (int b = 0; b < SIM_BUSES; b++)
+    {
+        buses[b].ResetStatistics();
+    }
+    OneWireMgr.ResetStats();
+    // a noisy sensor: recovered by the retry, then one that fails more times than retried
+    buses[0].InjectCrcErrors(0, 1);
+    buses[0].InjectCrcErrors(1, 100);
+    start = millis();
+    HostPlatform::RunFor(60 * 1000);
+    Serial.printf("60 s of polling: %lu ms simulated, %d temperature events, %d CRC errors\n", millis() - start,
+                  temperatureEvents, crcErrorEvents);
+    for (int b = 0; b < SIM_BUSES; b++)
+    {
+        Serial.printf("Bus %d: %llu us on the wire, %u resets, %u slots\n", 10 + b,
+                      (unsigned long long)buses[b].GetBusMicros(), buses[b].GetResets(), buses[b].GetSlots());
+    }
+    BusStats stats;
+    OneWireMgr.GetBusStats(10, stats);
+    Serial.printf("Bus 10 stats: %u cycles, %u reads, %u retries, %u CRC errors, read p50 %u us p99 %u us, "
+                  "conversion wait max %u us, cycle max %u us\n",
+                  stats.Cycles, stats.Reads, stats.Retries, stats.CrcErrors, LatencyPercentile(stats.Read, 0.5),
+                  LatencyPercentile(stats.Read, 0.99), stats.Conversion.Max, stats.Cycle.Max);
+
+    // bus 11: only the sensors out of their range are read, all of them - every 20th cycle
+    for (int i = 0; i < SIM_SENSORS_PER_BUS; i++)
+    {
+        Address1Wire addr;
+        buses[1].GetRom(i, addr.addr);
+        OneWireMgr.SetAlarmThresholds(addr, -10, i < 5 ? 15 : 60);
+    }
+    OneWireMgr.SetReadMode(11, READ_ALARMED);
+    // the thresholds are written by the next cycle (an EEPROM copy per sensor), then all sensors are read
+    HostPlatform::RunFor(2 * TIMER_LOOP_PERIOD_THERMOMETERS);
+    for (int b = 0; b < SIM_BUSES; b++)
+    {
+        buses[b].ResetStatistics();
+    }
+    HostPlatform::RunFor(60 * 1000);
+    Serial.printf("60 s of polling, bus 11 reads alarmed sensors only:\n");
+    for (int b = 0; b < SIM_BUSES; b++)
+    {
+        Serial.printf("Bus %d: %llu us on the wire, %u resets, %u slots\n", 10 + b,
+                      (unsigned long long)buses[b].GetBusMicros(), buses[b].GetResets(), buses[b].GetSlots());
+    }
+
+    // one event per bus per cycle instead of one per sensor
+    OneWireMgr.SetTemperatureBatch(true);
+    for (int i = 0; i < SIM_SENSORS_PER_BUS; i++)
+    {
+        buses[0].SetTemperature(i, 30.0f + i * 0.1f);
+    }
+    temperatureEvents = 0;
+    HostPlatform::RunFor(TIMER_LOOP_PERIOD_THERMOMETERS);
+    Serial.printf("Batched: %d temperature events, %d batch events with %d readings\n", temperatureEvents, batchEvents,
+                  batchReadings);
+
+    // noise around a rounding boundary: posted by the default filter, suppressed by the deadband
+    OneWireMgr.SetTemperatureBatch(false);
+    TemperatureFilter filter = {0.5, 0.2, 0, 0};
+    for (int pass = 0; pass < 2; pass++)
+    {
+        temperatureEvents = 0;
+        for (int cycle = 0; cycle < 8; cycle++)
+        {
+            for (int i = 0; i < SIM_SENSORS_PER_BUS; i++)
+            {
+                buses[0].SetTemperature(i, (cycle & 1) ? 21.0f : 21.25f);
+            }
+            HostPlatform::RunFor(TIMER_LOOP_PERIOD_THERMOMETERS);
+        }
+        Serial.printf("Noisy sensors, %s: %d temperature events in 8 cycles\n", pass == 0 ? "no filter" : "deadband 0.5",
+                      temperatureEvents);
+        OneWireMgr.SetTemperatureFilter(filter);
+    }
+
+    // 4 sensors of bus 10 every second, the rest at the default interval: the bus is not read at the fast rate
+    for (int i = 0; i < 4; i++)
+    {
+        Address1Wire addr;
+        buses[0].GetRom(i, addr.addr);
+        OneWireMgr.SetThermometerInterval(addr, 1000, 1);
+    }
+    HostPlatform::RunFor(TIMER_LOOP_PERIOD_THERMOMETERS);
+    buses[0].ResetStatistics();
+    HostPlatform::RunFor(60 * 1000);
+    Serial.printf("60 s of polling, 4 sensors of bus 10 every second:\n");
+    Serial.printf("Bus 10: %llu us on the wire, %u resets, %u slots\n", (unsigned long long)buses[0].GetBusMicros(),
+                  buses[0].GetResets(), buses[0].GetSlots());
+
+    // hot plug: the background search walks the tree between the cycles, the fast sensors are still read
+    buses[0].AddDevice(DS18B20MODEL, 5000);
+    OneWireMgr.ResetStats();
+    start = millis();
+    OneWireMgr.StartSearch();
+    HostPlatform::RunFor(60 * 1000);
+    OneWireMgr.GetBusStats(10, stats);
+    Serial.printf("Hot plug, background search: added after %lu ms, search %u us on bus 10, "
+                  "%u cycles of bus 10 in 60 s, cycle max %u us\n",
+                  addedAt - start, stats.Search.Max, stats.Cycles, stats.Cycle.Max);
+
+    // 50 dead sensors on bus 10: quarantined and probed with the backoff, the others keep their cycle
+    for (int i = 100; i < 150; i++)
+    {
+        buses[0].SetConnected(i, false);
+    }
+    OneWireMgr.ResetStats();
+    lostEvents = 0;
+    HostPlatform::RunFor(10 * 60 * 1000);
+    OneWireMgr.GetBusStats(10, stats);
+    Serial.printf("10 min with 50 dead sensors on bus 10: %d lost events, %u probes (%u reads without quarantine), "
+                  "cycle max %u us\n",
+                  lostEvents, stats.Probes, 50 * 40, stats.Cycle.Max);
+
+    // bus 11 shorted: one event for the bus, not one per sensor
+    for (int i = 0; i < SIM_SENSORS_PER_BUS; i++)
+    {
+        buses[1].SetConnected(i, false);
+    }
+    lostEvents = 0;
+    busEvents = 0;
+    HostPlatform::RunFor(60 * 1000);
+    for (int i = 0; i < SIM_SENSORS_PER_BUS; i++)
+    {
+        buses[1].SetConnected(i, true);
+    }
+    HostPlatform::RunFor(60 * 1000);
+    Serial.printf("Bus 11 shorted for 60 s: %d bus events, %d lost events\n", busEvents, lostEvents);
+
+    // a consumer busy for 45 s: the polling goes on, only the latest temperature of each sensor waits
+    OneWireMgr.ResetStats();
+    temperatureEvents = 0;
+    HostPlatform::StallEventLoop(45 * 1000);
+    for (int c = 0; c < 3; c++)
+    {
+        for (int i = 0; i < 10; i++)
+        {
+            buses[0].SetTemperature(i, 40.0f + c + i * 0.1f);
+        }
+        HostPlatform::RunFor(TIMER_LOOP_PERIOD_THERMOMETERS);
+    }
+    HostPlatform::RunFor(TIMER_LOOP_PERIOD_THERMOMETERS);
+    PostStats post;
+    OneWireMgr.GetPostStats(post);
+    OneWireMgr.GetBusStats(10, stats);
+    Serial.printf("Consumer stalled 45 s, non-blocking: %d temperature events, %u posted, %u coalesced, %u dropped, "
+                  "max %u pending, bus 10 cycle max %u us\n",
+                  temperatureEvents, post.Posted, post.Coalesced, post.Dropped, post.MaxPending, stats.Cycle.Max);
+
+    // the same with the blocking post of the earlier versions: the worker waits for the consumer
+    OneWireMgr.SetPostPolicy({portMAX_DELAY, POST_DROP_OLDEST, false});
+    OneWireMgr.ResetStats();
+    HostPlatform::StallEventLoop(45 * 1000);
+    for (int i = 0; i < 10; i++)
+    {
+        buses[0].SetTemperature(i, 50.0f + i * 0.1f);
+    }
+    HostPlatform::RunFor(4 * TIMER_LOOP_PERIOD_THERMOMETERS);
+    OneWireMgr.GetBusStats(10, stats);
+    Serial.printf("Consumer stalled 45 s, blocking: bus 10 cycle max %u us\n", stats.Cycle.Max);
+
+    // three sensors of bus 11 are needed now, the next periodic read is up to 15 s away:
+    // the first request starts a conversion, the ones made meanwhile share the next one
+    OneWireMgr.SetPostPolicy({0, POST_DROP_OLDEST, true});
+    HostPlatform::RunFor(TIMER_LOOP_PERIOD_THERMOMETERS / 3);
+    OneWireMgr.GetBusStats(11, stats);
+    uint32_t cycles = stats.Cycles;
+    unsigned long requestedAt = millis();
+    for (int i = 1; i <= 3; i++)
+    {
+        Address1Wire addr;
+        buses[1].GetRom(i + 10, addr.addr);
+        ReadRequest request = {readDone, NULL, NULL, false, (uint32_t)i};
+        OneWireMgr.RequestRead(addr, request);
+    }
+    HostPlatform::RunFor(2000);
+    OneWireMgr.GetBusStats(11, stats);
+    Serial.printf("On demand: 3 reads done in %lu, %lu, %lu ms by %u cycles of bus 11\n", readDoneAt[1] - requestedAt,
+                  readDoneAt[2] - requestedAt, readDoneAt[3] - requestedAt, stats.Cycles - cycles);
+    return 0;
+}
@@ -0,0 +1,61 @@
+// Fixed wiring declared at compile time, polled without any search, on a Linux host.
+// Build: pio run -e native_static_topology && .pio/build/native_static_topology/program
+#include <Arduino.h>
+#include "Async1WireMgr.hpp"
+#include "OneWireBusSim.hpp"
+#include "StaticTopology.hpp"
+
+// the ROM addresses are checked by the compiler: a typo in any byte fails the build
+STATIC_TOPOLOGY(wiring,
+                {10, {0x28, 0x01, 0x3C, 0x51, 0x0B, 0x00, 0x00, 0x1A}, "Boiler", false},
+                {10, {0x28, 0x02, 0x3C, 0x51, 0x0B, 0x00, 0x00, 0x43}, "Supply", false},
+                {10, {0x28, 0x03, 0x3C, 0x51, 0x0B, 0x00, 0x00, 0x74}, "Return", false},
+                {11, {0x28, 0x11, 0x3C, 0x51, 0x0B, 0x00, 0x00, 0x41}, "Outdoor", false},
+                {11, {0x28, 0x12, 0x3C, 0x51, 0x0B, 0x00, 0x00, 0x18}, "Attic", false});
+
+static constexpr uint8_t wrongCrc[8] = {0x28, 0x01, 0x3C, 0x51, 0x0B, 0x00, 0x00, 0x1B};
+static_assert(!StaticTopologyCheck::IsValidRom(wrongCrc), "CRC8 is checked at compile time");
+
+static int temperatureEvents = 0;
+
+void temperatureHandler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    TemperatureEvent *t = (TemperatureEvent *)event_data;
+    if (temperatureEvents++ < (int)wiring.Size())
+    {
+        Serial.printf("%s: %.1f\n", t->Name, t->Temperature);
+    }
+}
+
+int main()
+{
+    esp_event_handler_instance_register(ONEWIRE_EVENT, ONEWIRE_EVENT_TEMPERATURE, temperatureHandler, NULL, NULL);
+
+    OneWireBusSim buses[2];
+    for (size_t i = 0; i < wiring.Size(); i++)
+    {
+        OneWireBusSim &bus = buses[wiringTable[i].Pin - 10];
+        int d = bus.AddDevice(wiringTable[i].Rom);
+        bus.SetTemperature(d, 20.0f + i);
+    }
+    // a device which is not in the table is never polled
+    buses[0].AddDevice(DS18B20MODEL, 0x99);
+    OneWireMgr.Add1Wire(10, &buses[0]);
+    OneWireMgr.Add1Wire(11, &buses[1]);
+    OneWireMgr.SetTopologyStorage(&wiring);
+    OneWireMgr.SetDiscovery(false);
+
+    unsigned long start = millis();
+    OneWireMgr.Init();
+    unsigned long init = millis() - start;
+    HostPlatform::RunFor(60 * 1000);
+    Serial.printf("Init %lu ms, %d thermometers, %d temperature events in 60 s\n", init,
+                  OneWireMgr.GetNumbThermometers(), temperatureEvents);
+    for (int b = 0; b < 2; b++)
+    {
+        BusStats stats;
+        OneWireMgr.GetBusStats(10 + b, stats);
+        Serial.printf("Bus %d: %u searches, %u cycles, %u reads\n", 10 + b, stats.Searches, stats.Cycles, stats.Reads);
+    }
+    return 0;
+}
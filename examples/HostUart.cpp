@@ -0,0 +1,160 @@
+// Checks the UART 1-Wire transport on a Linux host.
+// Build: pio run -e native_uart && .pio/build/native_uart/program
+//
+// First the codec decodes the echoes as a logic analyser shows them on the line: a device answering 0 holds
+// the line low for 15..60 us after the start bit, which clears 1..6 low bits of the byte read back.
+// Then the manager polls simulated sensors through OneWireBusUart: the UART port is replaced by
+// the simulated line, each UART byte is one time slot of OneWireBusSim.
+#include <Arduino.h>
+#include "Async1WireMgr.hpp"
+#include "OneWireBusSim.hpp"
+#include "OneWireBusUart.hpp"
+#include "DS18x20.hpp"
+
+#define UART_SENSORS 20
+
+// echoes of a 0 slot: the low part stretched by the device
+static const uint8_t zeroEchoes[] = {0xFE, 0xFC, 0xF8, 0xF0, 0xE0, 0xC0, 0x80, 0x00};
+static const uint8_t presenceEchoes[] = {0xE0, 0xC0, 0x80, 0x90, 0x10};
+
+/// @brief UART on the simulated line.
+class SimUartPort : public OneWireUartPort
+{
+public:
+    SimUartPort(OneWireBusSim *line) : line(line) {}
+
+    void Begin(byte pin) override { line->begin(pin); }
+    void SetBaudRate(uint32_t baud) override { this->baud = baud; }
+    bool Transfer(const uint8_t *tx, uint8_t *rx, uint16_t count) override
+    {
+        transfers++;
+        bytes += count;
+        for (uint16_t i = 0; i < count; i++)
+        {
+            if (baud == ONEWIRE_UART_RESET_BAUD)
+            {
+                rx[i] = line->reset() ? presenceEchoes[echo++ % sizeof(presenceEchoes)] : ONEWIRE_UART_RESET_BYTE;
+            }
+            else if (line->TouchBit(tx[i] == ONEWIRE_UART_SLOT_ONE ? 1 : 0))
+            {
+                rx[i] = tx[i];
+            }
+            else
+            {
+                rx[i] = tx[i] == ONEWIRE_UART_SLOT_ZERO ? 0x00 : zeroEchoes[echo++ % sizeof(zeroEchoes)];
+            }
+        }
+        return true;
+    }
+    void SetStrongPullup(bool isOn) override
+    {
+        if (!isOn)
+        {
+            line->depower();
+        }
+    }
+
+    uint32_t transfers = 0;
+    uint32_t bytes = 0;
+
+private:
+    OneWireBusSim *line;
+    uint32_t baud = 0;
+    uint32_t echo = 0;
+};
+
+static int temperatureEvents = 0;
+
+void temperatureHandler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    temperatureEvents++;
+}
+
+static int checkCodec()
+{
+    int failures = 0;
+    if (OneWireUartCodec::DecodeReset(ONEWIRE_UART_RESET_BYTE) != UART_RESET_NO_PRESENCE ||
+        OneWireUartCodec::DecodeReset(0x00) != UART_RESET_SHORT)
+    {
+        failures++;
+    }
+    for (size_t i = 0; i < sizeof(presenceEchoes); i++)
+    {
+        if (OneWireUartCodec::DecodeReset(presenceEchoes[i]) != UART_RESET_PRESENCE)
+        {
+            failures++;
+        }
+    }
+
+    // scratchpad of a DS18B20 at 21.5 C, 12 bits, read back through the echoes
+    uint8_t scratchPad[DS18X20_SCRATCHPAD_SIZE] = {0x58, 0x01, 0x4B, 0x46, 0x7F, 0xFF, 0x08, 0x10, 0};
+    scratchPad[DS18X20_SCRATCHPAD_CRC] = OneWireBus::crc8(scratchPad, DS18X20_SCRATCHPAD_CRC);
+    uint8_t echoes[DS18X20_SCRATCHPAD_SIZE * 8];
+    int n = 0;
+    for (int i = 0; i < DS18X20_SCRATCHPAD_SIZE; i++)
+    {
+        for (int bit = 0; bit < 8; bit++, n++)
+        {
+            echoes[n] = ((scratchPad[i] >> bit) & 0x01) ? ONEWIRE_UART_SLOT_ONE : zeroEchoes[n % sizeof(zeroEchoes)];
+        }
+    }
+    uint8_t decoded[DS18X20_SCRATCHPAD_SIZE];
+    for (int i = 0; i < DS18X20_SCRATCHPAD_SIZE; i++)
+    {
+        decoded[i] = OneWireUartCodec::DecodeByte(&echoes[i * 8]);
+    }
+    if (memcmp(decoded, scratchPad, sizeof(scratchPad)) != 0 ||
+        OneWireBus::crc8(decoded, DS18X20_SCRATCHPAD_CRC) != decoded[DS18X20_SCRATCHPAD_CRC])
+    {
+        failures++;
+    }
+
+    // encode -> echo of idle devices -> decode
+    for (int v = 0; v < 256; v++)
+    {
+        uint8_t slots[8];
+        OneWireUartCodec::EncodeByte((uint8_t)v, slots);
+        if (OneWireUartCodec::DecodeByte(slots) != v)
+        {
+            failures++;
+        }
+    }
+    Serial.printf("Codec: %d failures\n", failures);
+    return failures;
+}
+
+int main()
+{
+    int failures = checkCodec();
+
+    esp_event_handler_instance_register(ONEWIRE_EVENT, ONEWIRE_EVENT_TEMPERATURE, temperatureHandler, NULL, NULL);
+    OneWireBusSim line;
+    for (int i = 0; i < UART_SENSORS; i++)
+    {
+        int d = line.AddDevice(DS18B20MODEL, i + 1);
+        line.SetTemperature(d, 20.0f + i * 0.5f);
+    }
+    SimUartPort port(&line);
+    OneWireBusUart bus(&port);
+    OneWireMgr.Add1Wire(10, &bus);
+    OneWireMgr.Init();
+    Serial.printf("Init: %d thermometers\n", OneWireMgr.GetNumbThermometers());
+
+    port.transfers = 0;
+    port.bytes = 0;
+    HostPlatform::RunFor(60 * 1000);
+    Serial.printf("60 s of polling: %d temperature events, %u UART transfers, %u bytes\n", temperatureEvents,
+                  port.transfers, port.bytes);
+    for (ThermometerHandle h = 0; h < OneWireMgr.GetNumbThermometers(); h++)
+    {
+        const Thermometer *t = OneWireMgr.GetThermometer(h);
+        int i = (int)(t->Address.addr[1] | (t->Address.addr[2] << 8)) - 1;
+        if (!t->Status || fabs(t->Temperature - (20.0f + i * 0.5f)) > 0.1)
+        {
+            Serial.printf("%s: %.2f, expected %.2f\n", t->Name, t->Temperature, 20.0f + i * 0.5f);
+            failures++;
+        }
+    }
+    Serial.printf("%s\n", failures == 0 ? "OK" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
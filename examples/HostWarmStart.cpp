@@ -0,0 +1,69 @@
+// Compares the cold start (full search) with the warm start from the topology cache on a Linux host.
+// Build: pio run -e native_warm_start && .pio/build/native_warm_start/program
+//
+// The program runs twice: the first run searches the buses and saves the topology to a file,
+// then it starts itself again with "warm", which loads the file and polls at once.
+#include <Arduino.h>
+#include <stdlib.h>
+#include <string>
+#include "Async1WireMgr.hpp"
+#include "OneWireBusSim.hpp"
+#include "TopologyStorage.hpp"
+#include "DS18x20.hpp"
+
+#define SIM_BUSES 2
+#define SIM_SENSORS_PER_BUS 60
+#define TOPOLOGY_FILE "/tmp/Async1WireTopology.bin"
+
+static unsigned long firstReading = 0;
+static int readings = 0;
+
+void temperatureHandler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    if (readings++ == 0)
+    {
+        firstReading = millis();
+    }
+}
+
+int main(int argc, char **argv)
+{
+    bool isWarm = argc > 1 && strcmp(argv[1], "warm") == 0;
+    if (!isWarm)
+    {
+        remove(TOPOLOGY_FILE);
+    }
+    esp_event_handler_instance_register(ONEWIRE_EVENT, ONEWIRE_EVENT_TEMPERATURE, temperatureHandler, NULL, NULL);
+
+    OneWireBusSim buses[SIM_BUSES];
+    for (int b = 0; b < SIM_BUSES; b++)
+    {
+        for (int i = 0; i < SIM_SENSORS_PER_BUS; i++)
+        {
+            int d = buses[b].AddDevice(DS18B20MODEL, b * 1000 + i + 1);
+            buses[b].SetTemperature(d, 20.0f + i * 0.1f);
+            if (isWarm)
+            {
+                // the sensors keep the resolution written by the first run in their EEPROM
+                buses[b].SetResolution(d, DEFAULT_RESOLUTION);
+            }
+        }
+        OneWireMgr.Add1Wire(10 + b, &buses[b]);
+    }
+    TopologyStorageFile storage(TOPOLOGY_FILE);
+    OneWireMgr.SetTopologyStorage(&storage);
+
+    // on the host the bus work is done inline, so Init() returns when the first check is over
+    unsigned long start = millis();
+    OneWireMgr.Init();
+    unsigned long init = millis() - start;
+    HostPlatform::RunFor(TOPOLOGY_SEARCH_DELAY + 1000);
+    Serial.printf("%s start: Init %lu ms, first reading at %lu ms, %d readings of %d sensors\n",
+                  isWarm ? "Warm" : "Cold", init, firstReading - start, readings, OneWireMgr.GetNumbThermometers());
+    if (!isWarm)
+    {
+        fflush(stdout);
+        return system((std::string(argv[0]) + " warm").c_str()) == 0 ? 0 : 1;
+    }
+    return 0;
+}
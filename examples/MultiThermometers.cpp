@@ -1,6 +1,5 @@
 #include <Arduino.h>
 #include "Async1WireMgr.hpp"
-#include <DallasTemperature.h>
 
 
 void thermometerHandler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
@@ -1,32 +1,115 @@
 #pragma once
 #include <map>
-#include <vector>
 #include <Arduino.h>
 #include <esp_event.h>
-#include <OneWire.h>
+#include "OneWireBus.hpp"
+#include "ThermometerPool.hpp"
+#include "DeadlineQueue.hpp"
+#include "TopologyStorage.hpp"
+#include "OneWireDriver.hpp"
+#ifdef ARDUINO
+#include "OneWireBusGpio.hpp"
+typedef OneWireBusGpio DefaultOneWireBus;
+#else
+#include "OneWireBusSim.hpp"
+typedef OneWireBusSim DefaultOneWireBus;
+#endif
 
 #ifndef TIMER_LOOP_PERIOD_THERMOMETERS
 #define TIMER_LOOP_PERIOD_THERMOMETERS 15 * 1000
 #endif
 
+// ms: the devices due within the window are converted by one cycle of their bus
+#ifndef SCHEDULE_BATCH_WINDOW
+#define SCHEDULE_BATCH_WINDOW 250
+#endif
+
+// ms after the warm start: the full search of the buses runs in the background
+#ifndef TOPOLOGY_SEARCH_DELAY
+#define TOPOLOGY_SEARCH_DELAY 5000
+#endif
+
+// background search: ROM branches (devices) searched by one step, ms between the steps of a bus
+#ifndef SEARCH_STEP_DEVICES
+#define SEARCH_STEP_DEVICES 4
+#endif
+
+#ifndef SEARCH_STEP_PERIOD
+#define SEARCH_STEP_PERIOD 20
+#endif
+
+// ms: the lost device is probed after 2, 4, 8... read intervals, not less often than this
+#ifndef LOST_PROBE_MAX_INTERVAL
+#define LOST_PROBE_MAX_INTERVAL (10 * 60 * 1000)
+#endif
+
 #ifndef DEFAULT_RESOLUTION
 #define DEFAULT_RESOLUTION 10
 #endif
 
+#ifndef SCRATCHPAD_READ_RETRIES
+#define SCRATCHPAD_READ_RETRIES 2
+#endif
+
+#ifndef ALARM_FULL_READ_CYCLES
+#define ALARM_FULL_READ_CYCLES 20
+#endif
+
+#ifndef TEMPERATURE_BATCH_SIZE
+#define TEMPERATURE_BATCH_SIZE 32
+#endif
+
+#ifndef WORKER_TASK_STACK_SIZE
+#define WORKER_TASK_STACK_SIZE 4096
+#endif
+
+#ifndef WORKER_TASK_PRIORITY
+#define WORKER_TASK_PRIORITY 5
+#endif
+
+#ifndef WORK_QUEUE_LENGTH
+#define WORK_QUEUE_LENGTH 16
+#endif
+
+// events waiting for room in the event loop queue, see SetPostPolicy()
+#ifndef POST_OUTBOX_LENGTH
+#define POST_OUTBOX_LENGTH 16
+#endif
+
+// RequestRead()/RequestBusRead() waiting at the same time
+#ifndef READ_REQUEST_SLOTS
+#define READ_REQUEST_SLOTS 8
+#endif
+
+// families with a driver given by RegisterDriver(), besides the built-in DS18x20
+#ifndef MAX_FAMILY_DRIVERS
+#define MAX_FAMILY_DRIVERS 4
+#endif
+
+// ms between the posts of the waiting events while the event loop is full
+#ifndef POST_RETRY_PERIOD
+#define POST_RETRY_PERIOD 10
+#endif
+
 #define SIZE_OF_ADDRESS_PRINTED (sizeof("00:00:00:00:00:00:00:00") - 1)
-#define LENGTH_OF_NAME 32
 
 ESP_EVENT_DECLARE_BASE(ONEWIRE_EVENT);
 typedef enum
 {
     ONEWIRE_EVENT_THERMOMETER,
-    ONEWIRE_EVENT_TEMPERATURE
+    ONEWIRE_EVENT_TEMPERATURE,
+    ONEWIRE_EVENT_TEMPERATURE_BATCH, // TemperatureBatchEvent, see SetTemperatureBatch()
+    ONEWIRE_EVENT_STATS,             // BusStatsEvent, see SetStatsInterval()
+    ONEWIRE_EVENT_BUS,               // BusEvent: the bus is suspended/resumed
+    ONEWIRE_EVENT_READ,              // ReadResult of RequestRead() with ReadRequest::IsEvent
+    ONEWIRE_EVENT_DEVICE             // DeviceEvent: the values of a device of a registered family changed
 } OneWireEvent;
 
 typedef enum
 {
     UNIT_OK,
-    UNIT_CRC_ERROR
+    UNIT_CRC_ERROR,
+    UNIT_NO_SPACE // MAX_THERMOMETERS are in use, the device is not added
 } UnitError;
 
 typedef enum
@@ -38,12 +121,6 @@ typedef enum
     UNIT_ERROR
 } ChangesEvent;
 
-typedef union
-{
-    byte addr[8];
-    int64_t packedAddress;
-} Address1Wire;
-
 typedef struct
 {
     char Name[LENGTH_OF_NAME];
@@ -60,25 +137,218 @@ typedef struct
     double Temperature;
 } TemperatureEvent;
 
+/// @brief Values read from a device of a family registered by Async1WireMgr::RegisterDriver().
+/// @details Posted when any value differs from the last read. The temperature of a thermometer family
+///          is posted as ONEWIRE_EVENT_TEMPERATURE too.
+typedef struct
+{
+    char Name[LENGTH_OF_NAME];
+    Address1Wire Address;
+    byte Pin;
+    DeviceValues Values; // see the driver of the family
+} DeviceEvent;
+
+typedef struct
+{
+    Address1Wire Address;
+    ThermometerHandle Handle; // see Async1WireMgr::GetThermometer()
+    float Temperature;
+    uint32_t Timestamp; // millis() of the read
+} TemperatureReading;
+
+/// @brief Changed temperatures of one bus for one cycle.
+/// @details Only Count readings are posted: the event data size is offsetof(Readings) + Count * sizeof(TemperatureReading).
+typedef struct
+{
+    byte Pin;
+    uint16_t Count;
+    TemperatureReading Readings[TEMPERATURE_BATCH_SIZE];
+} TemperatureBatchEvent;
+
+typedef struct
+{
+    byte Pin;
+    BusStats Stats;
+} BusStatsEvent;
+
+typedef enum
+{
+    BUS_SUSPENDED, // no presence pulse: nobody answers on the bus (short, cut wire, no devices)
+    BUS_RESUMED    // the devices answer again
+} BusEventType;
+
+/// @brief The bus fault, posted once instead of UNIT_CONNECTION_LOST of each device.
+/// @details The thermometers of a suspended bus keep their Status and temperature, they are not refreshed
+///          until BUS_RESUMED. The bus is probed by one reset at each deadline of its devices.
+typedef struct
+{
+    byte Pin;
+    BusEventType Event;
+} BusEvent;
+
+/// @brief Completion of RequestRead() or RequestBusRead().
+typedef struct
+{
+    uint32_t Token;           // ReadRequest::Token
+    ThermometerHandle Handle; // NO_THERMOMETER - the request of the whole bus
+    byte Pin;
+    bool IsRead;        // false: the device or the bus didn't answer, the CRC failed
+    double Temperature; // RequestRead(): the temperature read, the last one if !IsRead
+} ReadResult;
+
+typedef void (*ReadCallback)(const ReadResult &result, void *arg);
+
+/// @brief How the completion of RequestRead() is reported: any of the ways, or none of them.
+typedef struct
+{
+    ReadCallback Callback; // called by the worker of the bus: must be short and must not wait, nullptr - none
+    void *Arg;
+    TaskHandle_t Notify; // the task is notified by xTaskNotifyGive(), NULL - none
+    bool IsEvent;        // ONEWIRE_EVENT_READ with ReadResult is posted
+    uint32_t Token;      // copied to ReadResult to tell the requests apart
+} ReadRequest;
+
+/// @brief RequestRead() waiting for its read.
+typedef struct
+{
+    bool IsUsed;
+    bool IsClaimed;           // RequestBusRead(): the cycle of the request is running
+    ThermometerHandle Handle; // NO_THERMOMETER - the whole bus
+    int8_t Bus;
+    ReadRequest Request;
+} PendingRead;
+
+typedef enum
+{
+    POST_DROP_OLDEST, // the full outbox drops its oldest event for the new one
+    POST_DROP_NEWEST  // the full outbox drops the new event
+} PostOverflow;
+
+/// @brief How the events are posted, see Async1WireMgr::SetPostPolicy().
+typedef struct
+{
+    TickType_t Timeout;    // ticks to wait for room in the event loop queue, 0 - never, portMAX_DELAY - block
+    PostOverflow Overflow; // what is dropped when the outbox is full
+    bool IsCoalesced;      // a waiting temperature of the sensor is replaced by the newer one
+} PostPolicy;
+
+/// @brief Event waiting in the outbox of the manager.
+typedef struct
+{
+    int32_t EventId;          // ONEWIRE_EVENT_THERMOMETER, _TEMPERATURE, _BUS, _READ or _DEVICE
+    ThermometerHandle Handle; // ONEWIRE_EVENT_TEMPERATURE, _DEVICE: the device of the values
+    uint16_t Size;            // bytes of Data posted
+    union
+    {
+        ThermometerEvent Thermometer;
+        TemperatureEvent Temperature;
+        BusEvent Bus;
+        ReadResult Read;
+        DeviceEvent Device;
+    } Data;
+} PendingEvent;
+
 typedef enum
 {
     ONEWIRE_NONE,
     ONEWIRE_GENERIC,
-    ONEWIRE_DSTHERMO
+    ONEWIRE_DSTHERMO,
+    ONEWIRE_FAMILY_DRIVER // a family registered by RegisterDriver()
 } OneWireDevices;
 
+typedef enum
+{
+    CONVERSION_BROADCAST, // one Skip ROM conversion of each family for the whole bus, then the devices are read
+    CONVERSION_PER_DEVICE // Match ROM Convert T for each device
+} ConversionMode;
+
+typedef enum
+{
+    READ_ALL,     // the scratchpads of all devices are read each cycle
+    READ_ALARMED  // only the devices answering Alarm Search are read, all of them - every FullReadCycles cycle
+} ReadMode;
+
+typedef enum
+{
+    BUS_IDLE,              // no conversion in progress
+    BUS_CONVERTING_ALL,    // Skip ROM conversion started, the collect timer is armed
+    BUS_CONVERTING_DEVICE  // conversion of CycleDevice started, the collect timer is armed
+} BusPhase;
+
+typedef enum
+{
+    WORK_START_CYCLE, // dispatch the devices due to the buses
+    WORK_START_BUS,   // start conversion of the due devices of the bus
+    WORK_COLLECT,     // conversion is over on the bus, read the results
+    WORK_SEARCH,      // search devices on the bus
+    WORK_SEARCH_ALL,  // next step of the background search of all buses
+    WORK_SEARCH_STEP, // next step of the background search of the bus
+    WORK_VERIFY,      // check the devices loaded from the topology storage
+    WORK_STATS,       // post the statistics of all buses
+    WORK_SAVE,        // write the changed topology to the storage
+    WORK_POST,        // post the events waiting in the outbox
+    WORK_EXIT         // stop the worker of the bus
+} WorkType;
+
 typedef struct
 {
-    String Name;
-    Address1Wire Address;
+    WorkType Type;
     byte Pin;
-    bool Status;
-    bool IsParasitePowered;
-    byte Resolution;
-    double Temperature;
-} Thermometer;
+    TaskHandle_t Notify; // task to notify when the work is done, NULL - nobody
+} WorkItem;
 
+class Async1WireMgr;
 
+typedef struct
+{
+    Async1WireMgr *Manager;
+    QueueHandle_t Queue;
+    TaskHandle_t Task;
+} WorkerTask;
+
+typedef struct
+{
+    byte Pin;
+    int8_t Index;     // index of the bus in the collection and in the thermometer pool
+    OneWireBus *Wire; // nullptr - bus was removed
+    bool OwnsWire;    // Wire was created by manager in WireStorage
+    alignas(DefaultOneWireBus) uint8_t WireStorage[sizeof(DefaultOneWireBus)];
+    ConversionMode Mode;
+    bool IsParasitePowered; // at least one device on the bus is parasite powered
+    BusPhase Phase;
+    ReadMode Read;
+    uint16_t FullReadCycles;       // READ_ALARMED: cycles between the reads of all devices
+    uint16_t CyclesToFullRead;     // READ_ALARMED: cycles left to the next read of all devices
+    bool ConfigPending;            // some devices of the bus have the configuration to write
+    bool IsSuspended;              // no presence pulse, see BusEvent
+    uint32_t SearchCount;          // number of searches done on the bus
+    bool IsSearchRequested;        // background search: to start when the bus is idle, under the registry lock
+    bool IsSearching;              // background search: running, under the registry lock
+    OneWireSearchState SearchState; // background search: where the next step continues
+    uint32_t SearchTime;           // millis() of the start of the search: the due time of the devices found
+    uint32_t SearchMicros;         // bus time of the search steps so far
+    uint16_t DueCount;             // devices of the bus waiting for the conversion (ThermometerSchedule::IsDue)
+    TemperatureBatchEvent Batch;   // temperatures of the running cycle, see SetTemperatureBatch()
+    ThermometerHandle CycleDevice; // per device conversion: device being converted
+    uint32_t CycleStart;           // micros() of the conversion command of the running cycle
+    uint32_t ConversionStart;      // micros() of the last conversion command
+    BusStats Stats;                // under the registry lock
+    StaticTimer_t CollectTimerBuffer;
+    TimerHandle_t CollectTimer;
+    StaticSemaphore_t LockBuffer;
+    SemaphoreHandle_t Lock; // bus I/O and cycle state
+    bool HasOwnTask;        // the bus is served by its own worker
+    BaseType_t Core;
+    UBaseType_t Priority;
+    WorkerTask Worker;
+} OneWireBusUnit;
+
+
+/// @brief Manager of a set of buses and their thermometers.
+/// @details OneWireMgr is the default instance. The managers are independent: each one has its buses, worker,
+///          timers, schedule and event loop, so the buses of a gateway can be split by cadence or by consumer.
+///          A bus (pin) must belong to one manager only. Define ASYNC1WIRE_NO_GLOBAL_MANAGER to drop the default
+///          instance and its RAM.
 class Async1WireMgr
 {
 public:
@@ -92,41 +362,191 @@ public:
     ///       - It initializes all internal variables and starts timer.
     ///       - Initialize OneWire buses
     ///       - Search for devices
+    ///       - Start the worker task and the first conversion
+    ///
+    ///       With a topology storage (SetTopologyStorage) the known devices are loaded instead of the search.
+    ///       Each one is checked by a Match ROM scratchpad read, the polling starts at once and the full search
+    ///       is done in the background TOPOLOGY_SEARCH_DELAY ms later (not at all with SetDiscovery(false)).
+    ///       Init() doesn't wait for the buses then.
+    ///
+    ///       All bus I/O of the polling is done by the worker task. Each cycle is split in two phases:
+    ///       the conversion is started, then the results are collected by one-shot timer when the conversion
+    ///       time for the resolution is over. Nothing waits for the sensors in between.
     void Init();
 
     /// @brief Add OneWire bus to collection.
     /// @details You should add OneWireBus to collection any time. If you add bus after initialization, the bus will be initialized.
     /// @param pin - pin number to which the bus is connected.
+    /// @param bus - transport of the bus. nullptr - default one: OneWireBusGpio on target, OneWireBusSim on host.
     ///
     /// @return true, if bus was added successfully. Bus will be initialized when this method is called after Asnc1Wire mgr initialization.
     ///          false, if bus already exists in comllection.
-    bool Add1Wire(byte pin);
+    bool Add1Wire(byte pin, OneWireBus *bus = nullptr);
     /// @brief Remove OneWire bus from collection.
     /// @param pin
     /// @return true if bus was removed successfully. false if bus was not found.
     bool Remove1Wire(byte pin);
 
+    /// @brief Set temperature conversion mode of the bus.
+    /// @details CONVERSION_BROADCAST (default) starts conversion on all devices by one command and waits once,
+    ///          so a cycle takes one conversion time plus the scratchpad reads.
+    ///          A bus with a parasite powered device is always converted per device: the strong pullup
+    ///          can't feed all devices at once.
+    /// @param pin - pin number of the bus
+    /// @param mode - conversion mode
+    /// @return false if bus was not found.
+    bool SetConversionMode(byte pin, ConversionMode mode);
+
+    /// @brief Set which devices are read after the conversion.
+    /// @details READ_ALL (default) reads the scratchpad of every device each cycle.
+    ///          READ_ALARMED runs the Alarm Search after the conversion and reads only the devices
+    ///          with the temperature out of their TL..TH range (see SetAlarmThresholds). All devices are read
+    ///          every fullReadCycles cycle, the lost devices are detected on that cycle only.
+    ///          The mode needs CONVERSION_BROADCAST: a bus converted per device always reads all devices.
+    /// @param pin - pin number of the bus
+    /// @param mode - read mode
+    /// @param fullReadCycles - READ_ALARMED: number of cycles between the reads of all devices
+    /// @return false if bus was not found.
+    bool SetReadMode(byte pin, ReadMode mode, uint16_t fullReadCycles = ALARM_FULL_READ_CYCLES);
+
+    /// @brief Set alarm thresholds of the thermometer.
+    /// @details The thresholds are written to TL/TH registers (and EEPROM) of the device by the worker
+    ///          before the next conversion of the bus, only if the device has other ones. The alarm is raised
+    ///          by the device when the temperature is <= low or >= high.
+    /// @param addr - address of the thermometer
+    /// @param low - TL, whole degrees
+    /// @param high - TH, whole degrees
+    /// @return false if the thermometer is not in collection.
+    bool SetAlarmThresholds(Address1Wire addr, int8_t low, int8_t high);
+
+    /// @brief Set resolution of the thermometer.
+    /// @details The resolution is kept as the thresholds: written before the next conversion of the bus,
+    ///          only if the device has another one. The conversion wait follows the resolution
+    ///          the device was read with, so a 9 bit sensor is read after 94 ms instead of 750 ms.
+    /// @param addr - address of the thermometer
+    /// @param resolution - 9..12 bits, 0 - DEFAULT_RESOLUTION
+    /// @return false if the thermometer is not in collection.
+    bool SetResolution(Address1Wire addr, uint8_t resolution);
+
+    /// @brief Poll the devices of one more family.
+    /// @details The devices of the family are searched, named, scheduled, lost and restored as the thermometers,
+    ///          in the same pool and the same bus cycles. A cycle sends each distinct ConvertCommand()
+    ///          of its devices once by Skip ROM (DS18x20 and DS2438 share Convert T), waits for the longest
+    ///          conversion and reads all devices by one pass: the families without a conversion
+    ///          (e.g. DS2408, DS2413) are read without any wait. A bus converted per device converts each device
+    ///          by its driver. READ_ALARMED reads the devices of these families every cycle.
+    ///          The values are posted as ONEWIRE_EVENT_DEVICE, see GetDeviceValues().
+    ///          The DS18x20 families are built in. The families without a driver are not added by the search.
+    ///          Must be called before Init(). The driver must live as long as the manager.
+    /// @param family - family code, the first byte of the ROM
+    /// @param driver - e.g. static DS2438Driver, see FamilyDrivers.hpp
+    /// @return false for a DS18x20 family, nullptr or when MAX_FAMILY_DRIVERS families are registered.
+    bool RegisterDriver(uint8_t family, OneWireDriver *driver);
+
+    /// @brief Get the values of the last read of the device.
+    /// @return false if there is no such handle or the device was not read yet.
+    bool GetDeviceValues(ThermometerHandle h, DeviceValues &values);
+
+    /// @brief Serve the bus by its own worker task.
+    /// @details By default all buses are served one by one by the common worker.
+    ///          A bus with its own worker is searched and polled at the same time as the other buses,
+    ///          so the cycle takes as long as the slowest bus rather than the sum of all buses.
+    ///          SearchDevices() waits for the workers by task notifications of the calling task.
+    /// @param pin - pin number of the bus
+    /// @param core - core to run the task on, tskNO_AFFINITY - any
+    /// @param priority - priority of the task
+    /// @return false if bus was not found.
+    bool SetBusTask(byte pin, BaseType_t core = tskNO_AFFINITY, UBaseType_t priority = WORKER_TASK_PRIORITY);
+
+    /// @brief Keep the known devices in the storage for the warm start.
+    /// @details Must be set before Init(). The address, name, pin, resolution and power mode of each thermometer
+    ///          are written by the worker when a search or SetThermometerName() has changed them.
+    /// @param storage - TopologyStorageNvs on target, TopologyStorageFile on host. nullptr - no storage
+    void SetTopologyStorage(TopologyStorage *storage) { topologyStorage = storage; }
+
+    /// @brief Enable the search of the buses by Init() and SetThermometerName().
+    /// @details With a fixed wiring (StaticTopology) the search can be disabled: only the thermometers of
+    ///          the topology storage are polled, a lost one is restored by its own read. An explicit
+    ///          SearchDevices() still searches. Must be set before Init().
+    /// @param isEnabled - true (default): the buses are searched
+    void SetDiscovery(bool isEnabled) { isDiscovery = isEnabled; }
+
     /// @brief Search for devices on all buses.
     /// @details This method will search for devices on all buses and update internal collection of devices.
     ///          If new device was found, it will be added to collection.
     ///          This method doesn't remove any devices event if it is not found on the bus.
     ///         The devices not found are marked as Sttus=false
+    ///          The call blocks until all buses are searched, see StartSearch() for the background one.
     void SearchDevices();
 
+    /// @brief Search for devices on all buses in the background.
+    /// @details Returns at once. The worker searches SEARCH_STEP_DEVICES devices of a bus per step,
+    ///          every SEARCH_STEP_PERIOD ms, and only when the bus has no conversion cycle running,
+    ///          so the polling is never stopped. UNIT_ADDED is posted as the device is found,
+    ///          UNIT_CONNECTION_LOST when the search of its bus is over.
+    void StartSearch();
+
+    /// @brief Read the thermometer now, without waiting for its deadline.
+    /// @details Returns at once. The device is marked due and the conversion of its bus is started by the worker,
+    ///          with the other devices due then: the requests made before the bus starts are served by one
+    ///          conversion. A conversion of the device already running serves the request too.
+    ///          The read interval of the device is not changed. The completion is reported as the request says,
+    ///          by the worker of the bus. A lost device is probed, the result has IsRead == false then.
+    /// @param addr - address of the thermometer
+    /// @param request - how to report the completion
+    /// @return false if the thermometer is not found on a bus or READ_REQUEST_SLOTS requests are waiting.
+    bool RequestRead(Address1Wire addr, const ReadRequest &request);
+    /// @brief Read the thermometer now, see RequestRead(Address1Wire, ...).
+    /// @param name - name of the thermometer
+    bool RequestRead(const char *name, const ReadRequest &request);
+
+    /// @brief Read all thermometers of the bus now.
+    /// @details As RequestRead(), the completion is reported once, when the cycle of the bus is over:
+    ///          ReadResult::Handle is NO_THERMOMETER, the temperatures are in the snapshots (GetSnapshot).
+    /// @return false if the bus is not found, has no thermometers or READ_REQUEST_SLOTS requests are waiting.
+    bool RequestBusRead(byte pin, const ReadRequest &request);
+
     /// @brief Set name/Add thermometer to collection
     /// @details If thermometer with the same address already exists, it's name will be updated.
-    ///          If thermometer with the same address doesn't exists, it will be added to collection.
+    ///          If thermometer with the same address doesn't exists, it will be added to collection
+    ///          and looked for by the background search (StartSearch).
+    ///          The name is truncated to LENGTH_OF_NAME - 1 characters. Renaming doesn't allocate memory.
     /// @param newName
     /// @param addr
-    void SetThermometerName(String newName, Address1Wire addr);
+    void SetThermometerName(const char *newName, Address1Wire addr);
+    void SetThermometerName(String newName, Address1Wire addr) { SetThermometerName(newName.c_str(), addr); }
 
     /// @brief Get number of thermometers in collection.
     /// @return number of thermometers in collection.
-    int GetNumbThermometers() { return thermometers.size(); };
+    int GetNumbThermometers() { return pool.Count(); };
+
+    /// @brief Get thermometer by handle (ReadOnly).
+    /// @details Handles are 0..GetNumbThermometers()-1, a handle never changes.
+    ///          The record is changed by the worker while it is read: use GetSnapshot() from other tasks.
+    /// @return thermometer, nullptr if there is no such handle.
+    const Thermometer *GetThermometer(ThermometerHandle h);
+
+    /// @brief Get consistent copy of the thermometer state.
+    /// @details Lock free and allocation free: can be called from any task on any core while the buses are polled.
+    ///          The copy is never torn: a read which meets the write of the worker is repeated.
+    /// @return false if there is no such handle.
+    bool GetSnapshot(ThermometerHandle h, ThermometerSnapshot &snapshot) { return pool.ReadSnapshot(h, snapshot); }
+
+    /// @brief Get snapshots of all thermometers.
+    /// @details Lock free and allocation free, see GetSnapshot().
+    /// @param snapshots - buffer for the snapshots
+    /// @param size - size of the buffer
+    /// @return number of snapshots written.
+    int GetSnapshots(ThermometerSnapshot *snapshots, int size);
+
+    /// @brief Find thermometer by name.
+    /// @return handle of the thermometer, NO_THERMOMETER if not found.
+    ThermometerHandle FindThermometer(const char *name);
 
     /// @brief Get the collection of thermometers (ReadOnly)
+    /// @details The map is built on each call (heap is used). Use GetThermometer() in the loops.
     /// @return Collection of thermometers
-    const std::map<String, Thermometer *> GetThermometers() { return thermometers; };
+    const std::map<String, Thermometer *> GetThermometers();
     /// @brief Detect family of device by address.
     /// @details This method detects family of device by address.
     /// @param deviceAddress
@@ -134,10 +554,101 @@ public:
     OneWireDevices DetectFamily(Address1Wire deviceAddress);
 
     /// @brief Set interval for temperature loop.
-    /// @details This method sets interval for temperature loop.
+    /// @details This method sets the read interval of the thermometers without own interval (see SetThermometerInterval).
     ///          The temperature refreshed every interval. No refresh between intervals.
     ///          The default value is 15 seconds.(TIMER_LOOP_PERIOD_THERMOMETERS)
     void SetTemperatureTimerInterval(ulong interval);
+
+    /// @brief Set own read interval and priority of the thermometer.
+    /// @details Each thermometer has its deadline. One timer is armed to the earliest deadline of all thermometers,
+    ///          the devices due within SCHEDULE_BATCH_WINDOW are converted together by one cycle of their bus.
+    ///          So a fast sensor doesn't make the whole bus to be read at its rate.
+    ///          Of the devices due at the same time, the ones with higher priority are read first.
+    ///          The thermometer is read at once, then every interval.
+    /// @param addr - address of the thermometer
+    /// @param interval - ms, 0 - interval of the manager (SetTemperatureTimerInterval)
+    /// @param priority - 0 is the lowest
+    /// @return false if the thermometer is not in collection.
+    bool SetThermometerInterval(Address1Wire addr, uint32_t interval, uint8_t priority = 0);
+
+    /// @brief Set number of repeated scratchpad reads on CRC error.
+    /// @details Each sensor is read once per cycle. The read is repeated only when the CRC doesn't match.
+    ///          When all the retries fail, UNIT_ERROR event with UNIT_CRC_ERROR is sent and the last
+    ///          temperature is kept. The default value is SCRATCHPAD_READ_RETRIES.
+    void SetReadRetries(uint8_t retries) { readRetries = retries; }
+
+    /// @brief Post the changed temperatures by one event per bus per cycle.
+    /// @details When enabled, ONEWIRE_EVENT_TEMPERATURE_BATCH with TemperatureBatchEvent is posted when the cycle
+    ///          of the bus is over, instead of ONEWIRE_EVENT_TEMPERATURE for each sensor.
+    ///          A cycle with more than TEMPERATURE_BATCH_SIZE changes is posted by several events.
+    void SetTemperatureBatch(bool isBatch) { this->isBatch = isBatch; }
+
+    /// @brief Set the filter of temperature events for all thermometers without own filter.
+    /// @details The temperature is filtered before the event is posted, so the handlers and the event queue
+    ///          see the meaningful changes only. The thermometer state and the snapshots always have
+    ///          the last value read. The default filter (all zeros) posts every change of the value rounded to 0.1.
+    void SetTemperatureFilter(const TemperatureFilter &filter) { this->filter = filter; }
+
+    /// @brief Set own filter of temperature events of the thermometer.
+    /// @param addr - address of the thermometer
+    /// @param filter - filter, nullptr - use the global filter again
+    /// @return false if the thermometer is not in collection.
+    bool SetTemperatureFilter(Address1Wire addr, const TemperatureFilter *filter);
+
+    /// @brief Get counters and timings of the bus.
+    /// @details Searches, cycles, reads, retries, CRC failures, lost/restored devices and the histograms of
+    ///          the search, conversion command, conversion wait, scratchpad read and cycle durations.
+    ///          A growing Retries/CrcErrors or a Read histogram moving up points to a degrading cable,
+    ///          a Cycle histogram close to the read interval - to an overloaded bus.
+    /// @return false if bus was not found.
+    bool GetBusStats(byte pin, BusStats &stats);
+
+    /// @brief Get counters and read timings of the thermometer.
+    /// @return false if there is no such handle.
+    bool GetThermometerStats(ThermometerHandle h, SensorStats &stats);
+
+    /// @brief Keep the history of the reads of the thermometer.
+    /// @details Each read of the thermometer adds a sample: the time of the conversion start, the 12 bit value
+    ///          and the status (the lost and CRC failed reads too). The windows of the history are set before.
+    ///          The history is owned by the caller and must live as long as it is attached.
+    /// @param addr - address of the thermometer
+    /// @param history - e.g. static TemperatureHistoryBuffer<60>, nullptr - stop keeping the history
+    /// @return false if the thermometer is not in collection.
+    bool SetHistory(Address1Wire addr, TemperatureHistory *history);
+
+    /// @brief Get min, max, mean and count of the readings in the window of the thermometer history.
+    /// @details O(1): the aggregates are kept by each read, see TemperatureHistory.
+    /// @return false if there is no such handle, history or window.
+    bool GetHistoryAggregate(ThermometerHandle h, uint8_t window, HistoryAggregate &aggregate);
+
+    /// @brief Stream the history of the thermometer.
+    /// @details Copies the samples after the sample with the given sequence, the oldest first.
+    ///          Pass the Sequence of the last sample got to read only the new ones.
+    /// @param sequence - 0 - from the oldest sample kept
+    /// @return number of samples copied, 0 if there is no such handle or history.
+    uint16_t ReadHistory(ThermometerHandle h, uint32_t sequence, HistorySample *samples, uint16_t size);
+
+    /// @brief Clear the statistics of all buses and thermometers and the post counters.
+    void ResetStats();
+
+    /// @brief Post ONEWIRE_EVENT_STATS with BusStatsEvent for each bus periodically.
+    /// @param interval - ms, 0 - stop
+    void SetStatsInterval(uint32_t interval);
+
+    /// @brief Set how the events are posted to the event loop.
+    /// @details The worker never waits for the handlers longer than policy.Timeout (default 0), so the polling
+    ///          doesn't depend on the speed of the consumers. The thermometer, temperature and bus events which
+    ///          don't fit the event loop queue wait in the outbox (POST_OUTBOX_LENGTH) and are posted again
+    ///          every POST_RETRY_PERIOD ms, in their order. When the outbox is full, policy.Overflow drops
+    ///          the oldest or the new event. With policy.IsCoalesced a waiting temperature of the sensor
+    ///          is replaced by the newer one: only the latest temperature of a sensor is queued.
+    ///          The batch and stats events are too large for the outbox: they are dropped when the loop is full.
+    ///          The default is {0, POST_DROP_OLDEST, true}. {portMAX_DELAY, ...} blocks the worker
+    ///          until the handlers take the event, as the versions before.
+    void SetPostPolicy(const PostPolicy &policy);
+
+    /// @brief Get the counters of the posted, deferred, dropped and coalesced events.
+    void GetPostStats(PostStats &stats);
     /// @brief Print OneWire address to string.
     /// @param addr
     /// @return buffer with printed address. Please, note that the buffer is static and just one for all calls.
@@ -156,18 +667,121 @@ private:
     bool isInitialized = false;
     static char addrPrinted[SIZE_OF_ADDRESS_PRINTED + 1];
     ulong temperatureTimerInterval = TIMER_LOOP_PERIOD_THERMOMETERS;
-    std::map<byte, OneWire *> oneWireCollection;
-    std::map<String, Thermometer *> thermometers;
+    uint8_t readRetries = SCRATCHPAD_READ_RETRIES;
+    bool isBatch = false;
+    TemperatureFilter filter = {0, 0, 0, 0};
+    // the buses are never removed from the collection: Wire == nullptr marks removed bus, the unit is reused
+    OneWireBusUnit oneWireCollection[MAX_ONEWIRE_BUSES];
+    int numbBuses = 0;
+    ThermometerPool pool;
+    TopologyStorage *topologyStorage = nullptr;
+    bool isTopologyChanged = false; // under "lock"
+    bool isDiscovery = true;
+    PostPolicy postPolicy = {0, POST_DROP_OLDEST, true};
+    PostStats postStats = {};                // under "outboxLock"
+    PendingEvent outbox[POST_OUTBOX_LENGTH]; // ring of the events refused by the full event loop, under "outboxLock"
+    uint16_t outboxHead = 0;
+    uint16_t outboxCount = 0;
+    bool isPosting = false; // the outbox is being posted: a handler posting on the host loop only adds its event
+    PendingRead readRequests[READ_REQUEST_SLOTS] = {}; // under "lock"
+    uint8_t numbReadRequests = 0;
+    DeadlineQueue deadlines; // next reads of the thermometers, under "lock"
+    DS18x20Driver thermometerDriver;
+    uint8_t driverFamilies[MAX_FAMILY_DRIVERS];
+    OneWireDriver *drivers[MAX_FAMILY_DRIVERS]; // set before Init(): read by the workers without the lock
+    uint8_t numbDrivers = 0;
     esp_event_loop_handle_t eventLoop;
 
     StaticTimer_t temperatureLoopBuffer;
     TimerHandle_t temperatureLoopTimer;
+    StaticTimer_t statsBuffer;
+    TimerHandle_t statsTimer;
+    StaticTimer_t searchBuffer;
+    TimerHandle_t searchTimer; // steps of the background search, the first one is deferred by the warm start
+    StaticTimer_t postBuffer;
+    TimerHandle_t postTimer; // next post of the outbox while the event loop is full
+
+    // Locking: a bus worker holds the Lock of its bus during the bus I/O.
+    // "lock" protects the collections and the thermometer pool. It is taken last and for a short time only.
+    StaticSemaphore_t lockBuffer;
+    SemaphoreHandle_t lock;
+    // "outboxLock" protects the outbox and postStats, it is held by a post for policy.Timeout at most
+    StaticSemaphore_t outboxLockBuffer;
+    SemaphoreHandle_t outboxLock;
+    WorkerTask worker;
+#ifdef ARDUINO
+    StaticQueue_t workQueueBuffer;
+    uint8_t workQueueStorage[WORK_QUEUE_LENGTH * sizeof(WorkItem)];
+    static void workerLoop(void *arg);
+#endif
 
-    Thermometer *getThermometer(Address1Wire addr);
+    bool isBroadcast(OneWireBusUnit &unit) { return unit.Mode == CONVERSION_BROADCAST && !unit.IsParasitePowered; }
+    void readThermometer(OneWireBusUnit &unit, ThermometerHandle h);
+    OneWireDriver *findDriver(uint8_t family);
+    OneWireDriver *driverOf(ThermometerHandle h);
+    void addFoundDevice(OneWireBusUnit &unit, Address1Wire addr, uint32_t due);
+    void readAlarmed(OneWireBusUnit &unit);
+    bool requestRead(ThermometerHandle h, int8_t bus, const ReadRequest &request);
+    PendingRead *allocReadRequest();
+    void finishRead(const PendingRead &pending, const ReadResult &result);
+    void completeDeviceReads(OneWireBusUnit &unit, ThermometerHandle h, bool isRead);
+    void completeReads(OneWireBusUnit &unit);
+    void writeConfig(OneWireBusUnit &unit);
+    void setConfigPending(ThermometerHandle h);
+    bool isConfigDifferent(ThermometerHandle h);
+    void updateDeviceConfig(ThermometerHandle h, const uint8_t *scratchPad);
+    ThermometerHandle nextOnBus(OneWireBusUnit &unit, ThermometerHandle h);
+    ThermometerHandle nextInCycle(OneWireBusUnit &unit, ThermometerHandle h);
+    ThermometerHandle nextByPriority(OneWireBusUnit &unit, ThermometerHandle h);
+    void endCycle(OneWireBusUnit &unit);
+    bool claimDue(OneWireBusUnit &unit);
+    void schedule(ThermometerHandle h, uint32_t due);
+    void armScheduler();
+    uint32_t intervalOf(ThermometerHandle h);
+    void dispatchDue();
+    void postWork(OneWireBusUnit *unit, WorkType type, TaskHandle_t notify = NULL);
+    void processWork(WorkItem &item);
+    void runBusWork(OneWireBusUnit &unit, WorkType type);
+    void startBusTask(OneWireBusUnit &unit);
+    OneWireBusUnit *getBus(byte pin);
+    OneWireBusUnit *getBusAt(int index);
+    void searchBus(OneWireBusUnit &unit);
+    void startSearch(OneWireBusUnit &unit);
+    bool searchStep(OneWireBusUnit &unit, uint16_t devices);
+    void requestSearch();
+    void searchIdleBuses();
+    bool loadTopology();
+    void verifyBus(OneWireBusUnit &unit);
+    void saveTopology();
+    void startConversion(OneWireBusUnit &unit);
+    bool startBroadcast(OneWireBusUnit &unit);
+    void collect(OneWireBusUnit &unit);
+    bool convertNextDevice(OneWireBusUnit &unit);
+    void armCollectTimer(OneWireBusUnit &unit, uint32_t conversionTime);
+    void addStartLatency(OneWireBusUnit &unit, uint32_t start);
+    void abortCycle(OneWireBusUnit &unit);
+    void setBusSuspended(OneWireBusUnit &unit, bool isSuspended);
+    void quarantine(ThermometerHandle h);
+    uint32_t getConversionTime(OneWireBusUnit &unit);
+    static void onCollectTimer(TimerHandle_t xTimer);
     void notifyThermometerChanges(ThermometerEvent *t);
-    void notifyTemperatureChanges(TemperatureEvent *t);
+    void notifyTemperatureChanges(ThermometerHandle h, TemperatureEvent *t);
+    void notifyBusChanges(BusEvent *event);
+    void notifyDeviceChanges(ThermometerHandle h, DeviceEvent *event);
+    esp_err_t postToLoop(int32_t eventId, const void *data, size_t size);
+    void postEvent(int32_t eventId, const void *data, size_t size, ThermometerHandle h = NO_THERMOMETER);
+    void postOutbox();
+    void countDropped();
+    void publishTemperature(OneWireBusUnit &unit, ThermometerHandle h, TemperatureEvent &temperature);
+    void flushBatch(OneWireBusUnit &unit);
+    bool isToPost(ThermometerHandle h, double temperature, uint32_t now);
+    void notifyStats();
     static void onTemperatureLoopTimer(TimerHandle_t xTimer);
-    void requestTemperature();
+    static void onStatsTimer(TimerHandle_t xTimer);
+    static void onSearchTimer(TimerHandle_t xTimer);
+    static void onPostTimer(TimerHandle_t xTimer);
 };
 
-extern Async1WireMgr OneWireMgr;
\ No newline at end of file
+#ifndef ASYNC1WIRE_NO_GLOBAL_MANAGER
+extern Async1WireMgr OneWireMgr;
+#endif
\ No newline at end of file
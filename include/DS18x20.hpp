@@ -0,0 +1,109 @@
+#pragma once
+#include "OneWireBus.hpp"
+
+// Family codes of the supported thermometers
+#ifndef DS18S20MODEL
+#define DS18S20MODEL 0x10 // also DS1820
+#endif
+#ifndef DS18B20MODEL
+#define DS18B20MODEL 0x28 // also MAX31820
+#endif
+#ifndef DS1822MODEL
+#define DS1822MODEL 0x22
+#endif
+#ifndef DS1825MODEL
+#define DS1825MODEL 0x3B
+#endif
+#ifndef DS28EA00MODEL
+#define DS28EA00MODEL 0x42
+#endif
+
+#ifndef DEVICE_DISCONNECTED_C
+#define DEVICE_DISCONNECTED_C -127
+#endif
+
+// Function commands
+#define DS18X20_CONVERT_T 0x44
+#define DS18X20_WRITE_SCRATCHPAD 0x4E
+#define DS18X20_READ_SCRATCHPAD 0xBE
+#define DS18X20_COPY_SCRATCHPAD 0x48
+#define DS18X20_RECALL_EEPROM 0xB8
+#define DS18X20_READ_POWER_SUPPLY 0xB4
+
+// Scratchpad layout
+#define DS18X20_SCRATCHPAD_SIZE 9
+#define DS18X20_TEMP_LSB 0
+#define DS18X20_TEMP_MSB 1
+#define DS18X20_HIGH_ALARM_TEMP 2
+#define DS18X20_LOW_ALARM_TEMP 3
+#define DS18X20_CONFIGURATION 4
+#define DS18X20_COUNT_REMAIN 6
+#define DS18X20_COUNT_PER_C 7
+#define DS18X20_SCRATCHPAD_CRC 8
+
+typedef enum
+{
+    SCRATCHPAD_OK,          // CRC is OK
+    SCRATCHPAD_NO_DEVICE,   // all bytes 0xFF/0x00: the device didn't answer
+    SCRATCHPAD_CRC_ERROR,   // device answered, but the data is corrupted
+    SCRATCHPAD_NO_PRESENCE  // no presence pulse: no device on the bus answered the reset
+} ScratchPadStatus;
+
+/// @brief DS18x20 function layer on top of OneWireBus.
+/// @details Replaces DallasTemperature for the manager, which needs the commands to run on any OneWireBus backend.
+///          Temperatures are handled as raw values in 1/128 degree, like DallasTemperature does.
+class DS18x20
+{
+public:
+    /// @return true if the family code is one of the thermometers above.
+    static bool IsFamily(uint8_t family);
+
+    /// @brief Read the 9 bytes of the scratchpad.
+    /// @return false if no device answered the reset.
+    static bool ReadScratchPad(OneWireBus *bus, const uint8_t *rom, uint8_t *scratchPad);
+
+    /// @brief Check the scratchpad: CRC is OK and it is not all zeros (shorted bus).
+    static bool IsValidScratchPad(const uint8_t *scratchPad);
+
+    /// @brief Tell a missing device from a corrupted read.
+    static ScratchPadStatus CheckScratchPad(const uint8_t *scratchPad);
+
+    /// @brief Read the scratchpad once and check it.
+    /// @details The only read of the poll cycle: the status decides presence, the data gives the temperature.
+    static ScratchPadStatus ReadCheckedScratchPad(OneWireBus *bus, const uint8_t *rom, uint8_t *scratchPad);
+
+    /// @brief Read the scratchpad and check it.
+    /// @return true if device is connected and answers with a valid scratchpad.
+    static bool IsConnected(OneWireBus *bus, const uint8_t *rom, uint8_t *scratchPad);
+
+    /// @brief Write TH, TL and configuration bytes of the scratchpad.
+    /// @param copyToEeprom - copy the scratchpad to EEPROM after writing (~10ms)
+    static void WriteScratchPad(OneWireBus *bus, const uint8_t *rom, const uint8_t *scratchPad, bool copyToEeprom,
+                                bool parasite);
+
+    /// @brief Read power supply.
+    /// @param rom - device to ask, nullptr - ask all devices on the bus
+    /// @return true if the device (any device) is parasite powered.
+    static bool ReadPowerSupply(OneWireBus *bus, const uint8_t *rom);
+
+    /// @brief Start temperature conversion.
+    /// @param rom - device to convert, nullptr - all devices on the bus (Skip ROM)
+    /// @param parasite - keep the strong pullup on during conversion
+    /// @return false if no device answered the reset: nothing was sent.
+    static bool StartConversion(OneWireBus *bus, const uint8_t *rom, bool parasite);
+
+    /// @brief Calculate temperature from scratchpad.
+    /// @return Temperature in 1/128 degree.
+    static int32_t CalculateRaw(const uint8_t *rom, const uint8_t *scratchPad);
+
+    static float RawToCelsius(int32_t raw) { return (float)raw * 0.0078125f; }
+
+    /// @brief Resolution (9..12 bits) stored in the scratchpad.
+    static uint8_t GetResolution(const uint8_t *rom, const uint8_t *scratchPad);
+
+    /// @brief Configuration register value for the resolution (9..12 bits).
+    static uint8_t ResolutionToConfig(uint8_t resolution);
+
+    /// @brief Conversion time for the resolution: 93.75/187.5/375/750 ms, 0 (unknown) - 750 ms.
+    static uint32_t ConversionTimeMicros(uint8_t resolution);
+};
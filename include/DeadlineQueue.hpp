@@ -0,0 +1,42 @@
+#pragma once
+#include <Arduino.h>
+#include "ThermometerPool.hpp"
+
+// each thermometer has one live entry, the rest are stale entries of changed schedules
+#define DEADLINE_QUEUE_SIZE (2 * MAX_THERMOMETERS)
+
+/// @brief Fixed capacity min-heap of thermometer deadlines.
+/// @details The deadlines are millis() values: they are compared by the signed difference, so the order survives
+///          the wrap of millis(). Of two equal deadlines the one with higher priority goes first.
+///          Nothing is allocated on the heap. Not thread safe: the manager calls it under its registry lock.
+class DeadlineQueue
+{
+public:
+    typedef struct
+    {
+        uint32_t Due;
+        uint8_t Priority;
+        ThermometerHandle Handle;
+    } Entry;
+
+    /// @return false if the queue is full.
+    bool Push(uint32_t due, uint8_t priority, ThermometerHandle handle);
+    /// @brief The earliest entry. The queue must not be empty.
+    const Entry &Top() { return entries[0]; }
+    void Pop();
+    int Size() { return size; }
+    int Capacity() { return DEADLINE_QUEUE_SIZE; }
+    void Clear() { size = 0; }
+
+    /// @brief true if a is earlier than b.
+    static bool IsBefore(uint32_t a, uint32_t b) { return (int32_t)(a - b) < 0; }
+
+private:
+    Entry entries[DEADLINE_QUEUE_SIZE];
+    int size = 0;
+
+    bool isHigher(const Entry &a, const Entry &b)
+    {
+        return IsBefore(a.Due, b.Due) || (a.Due == b.Due && a.Priority > b.Priority);
+    }
+};
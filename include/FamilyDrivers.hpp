@@ -0,0 +1,77 @@
+#pragma once
+#include "OneWireDriver.hpp"
+
+// Family codes of the devices with a driver here
+#ifndef DS2438MODEL
+#define DS2438MODEL 0x26 // smart battery monitor
+#endif
+#ifndef DS2408MODEL
+#define DS2408MODEL 0x29 // 8-channel addressable switch
+#endif
+#ifndef DS2413MODEL
+#define DS2413MODEL 0x3A // dual channel addressable switch
+#endif
+
+// DS2438 function commands
+#define DS2438_CONVERT_T 0x44
+#define DS2438_CONVERT_V 0xB4
+#define DS2438_RECALL_MEMORY 0xB8
+#define DS2438_READ_SCRATCHPAD 0xBE
+
+// DS2438 page 0 layout: 8 bytes and CRC8, as the DS18x20 scratchpad
+#define DS2438_PAGE_SIZE 9
+#define DS2438_STATUS 0
+#define DS2438_TEMP_LSB 1
+#define DS2438_TEMP_MSB 2
+#define DS2438_VOLTAGE_LSB 3
+#define DS2438_VOLTAGE_MSB 4
+#define DS2438_CURRENT_LSB 5
+#define DS2438_CURRENT_MSB 6
+#define DS2438_CONVERSION_MICROS 10000
+
+// DS2408 function commands and registers
+#define DS2408_READ_PIO_REGISTERS 0xF0
+#define DS2408_PIO_LOGIC_STATE 0x88 // the first register read, up to 0x8F and the inverted CRC16
+#define DS2408_REGISTERS_SIZE 8
+
+// DS2413 function commands
+#define DS2413_PIO_ACCESS_READ 0xF5
+
+/// @brief DS2438: temperature, voltage and current of a battery.
+/// @details The temperature is converted with the DS18x20 of the bus by the shared Convert T.
+///          The voltage conversion (Convert V) is started by Match ROM right after each read, so the voltage
+///          is the one of the previous cycle: 0 on the first read after power up.
+///          Values[0] - temperature, degrees; Values[1] - voltage of the A/D input selected by the AD bit
+///          of the status register (VDD at power up), V; Values[2] - the current register, signed:
+///          divide by 4096 * Rsens (Ohm) for amperes.
+class DS2438Driver : public OneWireDriver
+{
+public:
+    uint8_t ConvertCommand() override { return DS2438_CONVERT_T; }
+    uint32_t ConversionTimeMicros(uint8_t /*resolution*/) override { return DS2438_CONVERSION_MICROS; }
+    ScratchPadStatus Read(OneWireBus *bus, const uint8_t *rom, uint8_t *data) override;
+    void Decode(const uint8_t *rom, const uint8_t *data, DeviceValues &values) override;
+    bool IsThermometer() override { return true; }
+};
+
+/// @brief DS2408: 8 PIO channels, nothing to convert.
+/// @details One read of the PIO registers 0x88..0x8F checked by CRC16.
+///          Values[0] - PIO logic state, Values[1] - PIO output latch state, Values[2] - activity latch state,
+///          one bit per channel.
+class DS2408Driver : public OneWireDriver
+{
+public:
+    ScratchPadStatus Read(OneWireBus *bus, const uint8_t *rom, uint8_t *data) override;
+    void Decode(const uint8_t *rom, const uint8_t *data, DeviceValues &values) override;
+};
+
+/// @brief DS2413: 2 PIO channels, nothing to convert.
+/// @details One byte of PIO Access Read, checked by its complement nibble.
+///          Values[0] - PIOA pin state, Values[1] - PIOB pin state, Values[2] - PIOA output latch,
+///          Values[3] - PIOB output latch: 0 or 1.
+class DS2413Driver : public OneWireDriver
+{
+public:
+    ScratchPadStatus Read(OneWireBus *bus, const uint8_t *rom, uint8_t *data) override;
+    void Decode(const uint8_t *rom, const uint8_t *data, DeviceValues &values) override;
+};
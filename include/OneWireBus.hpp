@@ -0,0 +1,91 @@
+#pragma once
+#include <Arduino.h>
+
+/// @brief Position of the ROM search: where the next search() continues the tree.
+typedef struct
+{
+    uint8_t Rom[8];
+    uint8_t LastDiscrepancy;
+    uint8_t LastFamilyDiscrepancy;
+    bool LastDeviceFlag;
+} OneWireSearchState;
+
+/// @brief Transport of one 1-Wire bus.
+/// @details Async1WireMgr talks to the wire only through this interface, so the same manager can run
+///          on the bit-banged OneWire library (OneWireBusGpio) or on the in-memory simulator (OneWireBusSim).
+///          The method names follow the OneWire library on purpose.
+///          A backend must implement the bit level (reset, read_bit, write_bit, depower).
+///          Byte transfers, ROM commands and the ROM search are built on top of it, but can be overridden
+///          when the backend has a faster way to do them.
+class OneWireBus
+{
+public:
+    virtual ~OneWireBus() {}
+
+    /// @brief Attach the backend to the pin.
+    /// @param pin - pin number to which the bus is connected.
+    virtual void begin(byte pin) = 0;
+
+    /// @brief Send the reset pulse and wait for the presence pulse.
+    /// @return 1 if at least one device answered, 0 otherwise.
+    virtual uint8_t reset() = 0;
+
+    /// @brief Write one time slot.
+    virtual void write_bit(uint8_t v) = 0;
+
+    /// @brief Read one time slot.
+    virtual uint8_t read_bit() = 0;
+
+    /// @brief Switch the strong pullup off.
+    /// @details The pullup is switched on by write(v, 1) / write_bytes(buf, count, true)
+    ///          and is released by this call or by the next time slot.
+    virtual void depower() = 0;
+
+    /// @brief Write one byte, LSB first.
+    /// @param power - keep the strong pullup on after the last bit (parasite powered devices).
+    virtual void write(uint8_t v, uint8_t power = 0);
+
+    /// @brief Read one byte, LSB first.
+    virtual uint8_t read();
+
+    virtual void write_bytes(const uint8_t *buf, uint16_t count, bool power = 0);
+    virtual void read_bytes(uint8_t *buf, uint16_t count);
+
+    /// @brief Match ROM (0x55): address a single device.
+    void select(const uint8_t rom[8]);
+
+    /// @brief Skip ROM (0xCC): address all devices on the bus.
+    void skip();
+
+    /// @brief Restart the ROM search from the beginning.
+    void reset_search();
+
+    /// @brief Restart the ROM search limited to one family code.
+    void target_search(uint8_t family_code);
+
+    /// @brief Find the next device.
+    /// @param newAddr - buffer of 8 bytes for ROM code found
+    /// @param search_mode - true: normal search (0xF0), false: alarm/conditional search (0xEC)
+    /// @return true if a device was found, false when there are no more devices.
+    bool search(uint8_t *newAddr, bool search_mode = true);
+
+    /// @brief Save the position of the search, e.g. to run another search (alarm search) in between.
+    void get_search_state(OneWireSearchState &state) const;
+
+    /// @brief Continue the search from the saved position.
+    void set_search_state(const OneWireSearchState &state);
+
+    /// @brief Dallas/Maxim CRC8 (polynomial X^8 + X^5 + X^4 + 1).
+    static uint8_t crc8(const uint8_t *addr, uint8_t len);
+
+    /// @brief Dallas/Maxim CRC16 (polynomial X^16 + X^15 + X^2 + 1) of the memory and PIO commands.
+    /// @details The devices send the inverted CRC, LSB first.
+    /// @param crc - CRC of the bytes before, to continue it
+    static uint16_t crc16(const uint8_t *input, uint16_t len, uint16_t crc = 0);
+
+protected:
+    uint8_t ROM_NO[8];
+    uint8_t LastDiscrepancy = 0;
+    uint8_t LastFamilyDiscrepancy = 0;
+    bool LastDeviceFlag = false;
+};
@@ -0,0 +1,20 @@
+#pragma once
+#include "OneWireBus.hpp"
+#include <OneWire.h>
+
+/// @brief 1-Wire bus bit-banged on a GPIO by the OneWire library.
+/// @details This is the default backend on the target.
+class OneWireBusGpio : public OneWireBus
+{
+public:
+    void begin(byte pin) override { wire.begin(pin); }
+    uint8_t reset() override { return wire.reset(); }
+    void write_bit(uint8_t v) override { wire.write_bit(v); }
+    uint8_t read_bit() override { return wire.read_bit(); }
+    void depower() override { wire.depower(); }
+    void write(uint8_t v, uint8_t power = 0) override { wire.write(v, power); }
+    uint8_t read() override { return wire.read(); }
+
+private:
+    OneWire wire;
+};
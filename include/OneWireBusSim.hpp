@@ -0,0 +1,152 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include "OneWireBus.hpp"
+
+// Standard speed slot costs, the same as the OneWire library spends
+#define SIM_RESET_MICROS 960
+#define SIM_WRITE_ONE_MICROS 65
+#define SIM_WRITE_ZERO_MICROS 70
+#define SIM_READ_MICROS 66
+
+/// @brief Deterministic in-memory 1-Wire bus.
+/// @details Models DS18B20/DS18S20/DS1822 devices at the time slot level: ROM commands, ROM and alarm search,
+///          scratchpad, EEPROM, conversion delays by resolution and parasite power.
+///          DS2438 (temperature and voltage of page 0), DS2408 (PIO registers) and DS2413 (PIO access read)
+///          answer the commands of their drivers, see FamilyDrivers.hpp.
+///          Every slot is charged with its standard speed duration. On the host build the virtual clock
+///          of HostPlatform is advanced by the same amount, so conversions complete in simulated time.
+class OneWireBusSim : public OneWireBus
+{
+public:
+    void begin(byte pin) override { this->pin = pin; }
+    uint8_t reset() override;
+    void write_bit(uint8_t v) override;
+    uint8_t read_bit() override;
+    void depower() override;
+
+    /// @brief One time slot as the line sees it: 0 - write 0, 1 - write 1 or read, the devices decide which one.
+    /// @details For the transports which can't tell the read slot from the write 1 slot (see OneWireBusUart).
+    /// @return the level of the line in the slot.
+    uint8_t TouchBit(uint8_t v);
+
+    /// @brief Add device to the bus.
+    /// @param rom - ROM code. The last byte (CRC) is calculated.
+    /// @param parasite - device is parasite powered
+    /// @return index of the device
+    int AddDevice(const uint8_t *rom, bool parasite = false);
+
+    /// @brief Add device with ROM built from family code and serial number.
+    int AddDevice(uint8_t family, uint32_t serial, bool parasite = false);
+
+    /// @brief Number of devices on the bus.
+    int GetNumbDevices() { return (int)devices.size(); }
+
+    /// @brief Get ROM code of device.
+    void GetRom(int device, uint8_t *rom);
+
+    /// @brief Set temperature measured by the next conversion.
+    void SetTemperature(int device, float temperature);
+
+    /// @brief Set the resolution kept by the EEPROM of DS18B20/DS1822, as if it was written before the power up.
+    void SetResolution(int device, uint8_t resolution);
+
+    /// @brief Set voltage measured by the next voltage conversion of DS2438.
+    void SetVoltage(int device, float voltage);
+
+    /// @brief Set the PIO pin states of DS2408 (8 bits) or DS2413 (bit 0 - PIOA, bit 1 - PIOB).
+    void SetPio(int device, uint8_t pio);
+
+    /// @brief Connect/disconnect device from the bus.
+    void SetConnected(int device, bool connected);
+
+    /// @brief Corrupt the next scratchpad reads of device (the CRC doesn't match).
+    /// @param count - number of reads to corrupt
+    void InjectCrcErrors(int device, uint32_t count);
+
+    /// @brief Total time of all time slots since start (or ResetStatistics), microseconds.
+    uint64_t GetBusMicros() { return busMicros; }
+    /// @brief Number of reset pulses since start (or ResetStatistics).
+    uint32_t GetResets() { return resets; }
+    /// @brief Number of read/write time slots since start (or ResetStatistics).
+    uint32_t GetSlots() { return slots; }
+    void ResetStatistics();
+
+private:
+    typedef enum
+    {
+        SIM_IDLE,
+        SIM_ROM_COMMAND,
+        SIM_MATCH_ROM,
+        SIM_SEARCH,
+        SIM_READ_ROM,
+        SIM_FUNCTION_COMMAND,
+        SIM_FUNCTION_ARGS, // the address/page bytes of the command
+        SIM_CONVERT,
+        SIM_READ_SCRATCHPAD,
+        SIM_WRITE_SCRATCHPAD,
+        SIM_COPY_SCRATCHPAD,
+        SIM_READ_POWER,
+        SIM_READ_DATA, // the bytes prepared by the command
+        SIM_DONE
+    } SimState;
+
+    typedef struct
+    {
+        uint8_t Rom[8];
+        uint8_t ScratchPad[9];
+        uint8_t Eeprom[3]; // TH, TL, configuration
+        bool IsParasitePowered;
+        bool IsConnected;
+        bool IsConverting;
+        bool IsAlarm;
+        uint64_t ConversionEnd;
+        float Temperature;
+        uint32_t CrcErrors; // number of scratchpad reads to corrupt
+        uint8_t Memory[8];  // DS2438: page 0, DS2408: the PIO registers 0x88..0x8F
+        float Voltage;      // DS2438
+        uint8_t Pio;        // DS2408, DS2413: the pin states
+    } SimDevice;
+
+    byte pin = 0;
+    std::vector<SimDevice> devices;
+    std::unordered_map<uint64_t, int> romIndex;
+    int connectedDevices = 0;
+
+    SimState state = SIM_IDLE;
+    bool allSelected = false; // all connected devices are addressed, "selected" is not built
+    std::vector<int> selected;
+    uint8_t bitIndex = 0;
+    uint8_t rxByte = 0;
+    uint8_t searchPhase = 0;
+    uint8_t byteIndex = 0;
+    uint8_t romBits[8];
+    bool pullup = false;
+    bool corruptRead = false; // the running scratchpad read is corrupted
+    uint8_t function = 0;     // the function command waiting for its arguments
+    uint8_t args[2];
+    uint8_t argCount = 0;
+    uint8_t argsNeeded = 0;
+    uint8_t readBuffer[16]; // SIM_READ_DATA
+    uint8_t readLength = 0;
+
+    uint64_t busMicros = 0;
+    uint32_t resets = 0;
+    uint32_t slots = 0;
+
+    void spend(uint32_t us);
+    uint64_t now();
+    void releasePullup();
+    void selectAll();
+    void settle(SimDevice &d);
+    void latchTemperature(SimDevice &d, float temperature);
+    void updateCrc(SimDevice &d);
+    void onRomCommand(uint8_t cmd);
+    void onFunctionCommand(uint8_t cmd);
+    bool onDeviceCommand(uint8_t cmd);
+    void onFunctionArgs();
+    uint8_t selectedFamily();
+    void latchVoltage(SimDevice &d);
+    void latchPio(SimDevice &d);
+    static uint8_t bitOf(const uint8_t *buf, uint8_t bit) { return (buf[bit >> 3] >> (bit & 7)) & 0x01; }
+};
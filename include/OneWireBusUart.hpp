@@ -0,0 +1,111 @@
+#pragma once
+#include "OneWireBus.hpp"
+#ifdef ARDUINO
+#include <driver/uart.h>
+#endif
+
+// The reset pulse is one byte at 9600 baud: start bit + 4 zero bits hold the line low for 520 us
+#define ONEWIRE_UART_RESET_BAUD 9600
+#define ONEWIRE_UART_RESET_BYTE 0xF0
+// A time slot is one byte at 115200 baud: 0x00 holds the line low for 78 us (write 0),
+// 0xFF releases it after the start bit (write 1 or read). A device sending 0 stretches the low part.
+#define ONEWIRE_UART_SLOT_BAUD 115200
+#define ONEWIRE_UART_SLOT_ZERO 0x00
+#define ONEWIRE_UART_SLOT_ONE 0xFF
+
+// bytes of 1-Wire data sent by one UART transfer (8 UART bytes each)
+#ifndef ONEWIRE_UART_CHUNK
+#define ONEWIRE_UART_CHUNK 16
+#endif
+
+typedef enum
+{
+    UART_RESET_NO_PRESENCE, // the echo is the reset byte: nobody pulled the line
+    UART_RESET_PRESENCE,
+    UART_RESET_SHORT // the line stayed low
+} UartResetResult;
+
+/// @brief Encoding of 1-Wire time slots as UART bytes and decoding of the echo read back.
+/// @details TX and RX are on the same open drain line, so each byte sent is received back as the devices left it.
+///          Pure functions: they are checked on the host against recorded echoes (examples/HostUart.cpp).
+class OneWireUartCodec
+{
+public:
+    static uint8_t EncodeBit(uint8_t v) { return v ? ONEWIRE_UART_SLOT_ONE : ONEWIRE_UART_SLOT_ZERO; }
+    /// @brief Any low bit after the start bit means a device held the line: 0.
+    static uint8_t DecodeBit(uint8_t echo) { return echo == ONEWIRE_UART_SLOT_ONE ? 1 : 0; }
+    /// @brief 8 slot bytes of v, LSB first. Read slots are EncodeByte(0xFF).
+    static void EncodeByte(uint8_t v, uint8_t *slots);
+    static uint8_t DecodeByte(const uint8_t *echo);
+    static UartResetResult DecodeReset(uint8_t echo);
+};
+
+/// @brief Half duplex UART with TX and RX on the 1-Wire line.
+/// @details The platform part of OneWireBusUart. Transfer() only queues the bytes and waits for the echo:
+///          the bits are timed by the UART, the CPU is free for the other tasks meanwhile.
+class OneWireUartPort
+{
+public:
+    virtual ~OneWireUartPort() {}
+    virtual void Begin(byte pin) = 0;
+    virtual void SetBaudRate(uint32_t baud) = 0;
+    /// @brief Send count bytes and receive the echo.
+    /// @return false if the echo didn't come in time.
+    virtual bool Transfer(const uint8_t *tx, uint8_t *rx, uint16_t count) = 0;
+    /// @brief Drive the line high (push-pull) for parasite powered devices, false - open drain again.
+    virtual void SetStrongPullup(bool isOn) = 0;
+};
+
+/// @brief 1-Wire bus timed by a UART instead of bit-banging.
+/// @details The OneWire library bit-bangs each slot with the interrupts disabled. Here a byte transfer is
+///          one UART transaction of 8 slot bytes and a scratchpad read is one transaction of 72: the calling
+///          task waits for the echo without spinning. Needs an external pullup on the line.
+class OneWireBusUart : public OneWireBus
+{
+public:
+    OneWireBusUart(OneWireUartPort *port) : port(port) {}
+
+    void begin(byte pin) override;
+    uint8_t reset() override;
+    void write_bit(uint8_t v) override;
+    uint8_t read_bit() override;
+    void depower() override;
+    void write(uint8_t v, uint8_t power = 0) override;
+    uint8_t read() override;
+    void write_bytes(const uint8_t *buf, uint16_t count, bool power = 0) override;
+    void read_bytes(uint8_t *buf, uint16_t count) override;
+
+    /// @brief Result of the last reset pulse.
+    UartResetResult GetLastReset() { return lastReset; }
+
+private:
+    OneWireUartPort *port;
+    uint32_t baud = 0;
+    bool isPowered = false;
+    UartResetResult lastReset = UART_RESET_NO_PRESENCE;
+    uint8_t tx[ONEWIRE_UART_CHUNK * 8];
+    uint8_t rx[ONEWIRE_UART_CHUNK * 8];
+
+    void setBaudRate(uint32_t baud);
+    bool transfer(uint16_t count);
+};
+
+#ifdef ARDUINO
+/// @brief OneWireUartPort on an ESP32 UART driven by the ESP-IDF driver (ISR filled ring buffer).
+/// @details TX and RX are routed to the same GPIO in open drain mode.
+class OneWireUartPortEsp : public OneWireUartPort
+{
+public:
+    OneWireUartPortEsp(uart_port_t uart) : uart(uart) {}
+
+    void Begin(byte pin) override;
+    void SetBaudRate(uint32_t baud) override;
+    bool Transfer(const uint8_t *tx, uint8_t *rx, uint16_t count) override;
+    void SetStrongPullup(bool isOn) override;
+
+private:
+    uart_port_t uart;
+    byte pin = 0;
+    uint32_t baud = ONEWIRE_UART_SLOT_BAUD;
+};
+#endif
@@ -0,0 +1,80 @@
+#pragma once
+#include "OneWireBus.hpp"
+#include "DS18x20.hpp"
+
+// values decoded from one read of a device
+#ifndef DRIVER_MAX_VALUES
+#define DRIVER_MAX_VALUES 4
+#endif
+
+// bytes of one read: the scratchpad, memory page or registers with their CRC
+#define DRIVER_DATA_SIZE 16
+
+/// @brief Values of one read, their meaning is given by the driver of the family.
+typedef struct
+{
+    uint8_t Count;
+    float Values[DRIVER_MAX_VALUES];
+} DeviceValues;
+
+/// @brief Commands of one device family: how the devices are converted, read and decoded.
+/// @details Registered per family code by Async1WireMgr::RegisterDriver(). A bus cycle converts the devices
+///          of all its families together: each distinct ConvertCommand() of the devices due is sent once by
+///          Skip ROM, the cycle waits for the longest conversion, then every device is read by one pass.
+///          The driver keeps no state of the devices: one instance serves all buses and is called by their
+///          workers at the same time.
+class OneWireDriver
+{
+public:
+    virtual ~OneWireDriver() {}
+
+    /// @brief Function command which converts the devices after Skip ROM, 0 - the family has no conversion.
+    /// @details The families with the same command (e.g. Convert T 0x44) are converted by one broadcast.
+    ///          A device without a conversion is read as soon as its bus cycle starts.
+    virtual uint8_t ConvertCommand() { return 0; }
+
+    /// @brief Time of the conversion.
+    /// @param resolution - resolution read from the device, 0 - unknown
+    /// @return us
+    virtual uint32_t ConversionTimeMicros(uint8_t /*resolution*/) { return 0; }
+
+    /// @brief Start the conversion.
+    /// @details The default sends ConvertCommand() after the ROM command.
+    /// @param rom - device to convert, nullptr - all devices on the bus (Skip ROM)
+    /// @param parasite - keep the strong pullup on during conversion
+    /// @return false if no device answered the reset: nothing was sent.
+    virtual bool StartConversion(OneWireBus *bus, const uint8_t *rom, bool parasite);
+
+    /// @brief Read the data of the device once and check it.
+    /// @param data - DRIVER_DATA_SIZE bytes
+    /// @return SCRATCHPAD_NO_PRESENCE tells the bus fault from the missing device, as DS18x20 does.
+    virtual ScratchPadStatus Read(OneWireBus *bus, const uint8_t *rom, uint8_t *data) = 0;
+
+    /// @brief Decode the data of a successful Read().
+    virtual void Decode(const uint8_t *rom, const uint8_t *data, DeviceValues &values) = 0;
+
+    /// @brief Values[0] is the temperature, degrees.
+    /// @details The temperature of a thermometer family is filtered, posted and kept in the history as the one
+    ///          of DS18x20.
+    virtual bool IsThermometer() { return false; }
+};
+
+/// @brief DS18S20/DS18B20/DS1822/DS1825/DS28EA00: the built-in driver of the manager.
+/// @details Values[0] is the temperature. The resolution, alarms and alarm search stay with the manager:
+///          they are handled for these families only.
+class DS18x20Driver : public OneWireDriver
+{
+public:
+    uint8_t ConvertCommand() override { return DS18X20_CONVERT_T; }
+    uint32_t ConversionTimeMicros(uint8_t resolution) override { return DS18x20::ConversionTimeMicros(resolution); }
+    bool StartConversion(OneWireBus *bus, const uint8_t *rom, bool parasite) override
+    {
+        return DS18x20::StartConversion(bus, rom, parasite);
+    }
+    ScratchPadStatus Read(OneWireBus *bus, const uint8_t *rom, uint8_t *data) override
+    {
+        return DS18x20::ReadCheckedScratchPad(bus, rom, data);
+    }
+    void Decode(const uint8_t *rom, const uint8_t *data, DeviceValues &values) override;
+    bool IsThermometer() override { return true; }
+};
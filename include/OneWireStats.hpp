@@ -0,0 +1,65 @@
+#pragma once
+#include <Arduino.h>
+
+// bucket i counts the durations of [2^i, 2^(i+1)) us, the last one everything longer (~0.5 s)
+#ifndef STATS_HISTOGRAM_BUCKETS
+#define STATS_HISTOGRAM_BUCKETS 20
+#endif
+
+/// @brief Log2 histogram of durations in microseconds.
+/// @details Fixed size, Add() is a few instructions: it is updated on the hot path of the poll.
+typedef struct
+{
+    uint32_t Count;
+    uint32_t Max; // us
+    uint64_t Sum; // us
+    uint32_t Buckets[STATS_HISTOGRAM_BUCKETS];
+} LatencyHistogram;
+
+/// @brief Counters and timings of one bus, see Async1WireMgr::GetBusStats().
+typedef struct
+{
+    uint32_t Searches;
+    uint32_t Cycles;    // conversion cycles of the bus
+    uint32_t Reads;     // scratchpad reads, a read with retries is counted once
+    uint32_t Retries;   // reads repeated because of the CRC
+    uint32_t CrcErrors; // reads given up because of the CRC (UNIT_CRC_ERROR)
+    uint32_t Lost;      // UNIT_CONNECTION_LOST of the devices of the bus
+    uint32_t Restored;  // UNIT_CONNECTION_RESTORED of the devices of the bus
+    uint32_t Probes;    // reads of the lost devices (quarantine)
+    uint32_t Suspends;  // BUS_SUSPENDED: no presence pulse on the bus
+    LatencyHistogram Search;     // ROM search of the whole bus, the sum of its steps
+    LatencyHistogram Start;      // conversion command: reset, ROM command, Convert T
+    LatencyHistogram Conversion; // from the conversion command to the collect of the results
+    LatencyHistogram Read;       // scratchpad read of one device, with the retries
+    LatencyHistogram Cycle;      // from the conversion command to the last read of the cycle
+} BusStats;
+
+/// @brief Counters and timings of one thermometer, see Async1WireMgr::GetThermometerStats().
+typedef struct
+{
+    uint32_t Reads;
+    uint32_t Retries;
+    uint32_t CrcErrors;
+    uint32_t Lost;     // the device was lost and restored Restored times: a flapping sensor has both growing
+    uint32_t Restored;
+    LatencyHistogram Read;
+} SensorStats;
+
+/// @brief Counters of the event posting, see Async1WireMgr::GetPostStats().
+typedef struct
+{
+    uint32_t Posted;     // events taken by the event loop
+    uint32_t Deferred;   // posts refused by the full event loop, the event waits in the outbox
+    uint32_t Dropped;    // events lost: the outbox was full, or a batch/stats event met the full loop
+    uint32_t Coalesced;  // waiting temperatures replaced by a newer one of the same sensor
+    uint16_t Pending;    // events in the outbox now
+    uint16_t MaxPending; // the most events in the outbox
+} PostStats;
+
+/// @brief Add the duration to the histogram.
+void AddLatency(LatencyHistogram &histogram, uint32_t micros);
+
+/// @brief Duration below which the given share of the histogram is, us (the upper bound of the bucket).
+/// @param share - 0..1, e.g. 0.99
+uint32_t LatencyPercentile(const LatencyHistogram &histogram, double share);
@@ -0,0 +1,133 @@
+#pragma once
+#include <stddef.h>
+#include "TopologyStorage.hpp"
+#include "DS18x20.hpp"
+#include "FamilyDrivers.hpp"
+
+/// @brief One device of a fixed wiring, see STATIC_TOPOLOGY.
+/// @details An aggregate, so all fields are given: {pin, {ROM}, "name", parasite}. A default value of a field
+///          would need C++14.
+typedef struct
+{
+    byte Pin;
+    uint8_t Rom[8];
+    const char *Name;
+    bool IsParasitePowered;
+} StaticThermometer;
+
+/// @brief Compile time checks of a StaticThermometer table.
+/// @details C++11 constexpr: each function is one return statement, loops are recursions.
+class StaticTopologyCheck
+{
+public:
+    /// @brief Dallas/Maxim CRC8, the same as OneWireBus::crc8().
+    static constexpr uint8_t Crc8(const uint8_t *data, uint8_t len, uint8_t crc = 0)
+    {
+        return len == 0 ? crc : Crc8(data + 1, len - 1, crc8Bits(crc, data[0], 8));
+    }
+
+    static constexpr bool IsThermometerFamily(uint8_t family)
+    {
+        return family == DS18S20MODEL || family == DS18B20MODEL || family == DS1822MODEL ||
+               family == DS1825MODEL || family == DS28EA00MODEL;
+    }
+
+    /// @brief A family of the drivers of FamilyDrivers.hpp: its driver is registered before Init().
+    static constexpr bool IsDriverFamily(uint8_t family)
+    {
+        return family == DS2438MODEL || family == DS2408MODEL || family == DS2413MODEL;
+    }
+
+    /// @brief The ROM has a valid CRC8 and the family of a DS18x20 thermometer or of a driver of FamilyDrivers.hpp.
+    /// @details The devices of the other families with a driver of their own are found by the search only.
+    static constexpr bool IsValidRom(const uint8_t *rom)
+    {
+        return (IsThermometerFamily(rom[0]) || IsDriverFamily(rom[0])) && Crc8(rom, 7) == rom[7];
+    }
+
+    /// @brief All ROMs are valid, have a name, and no ROM is there twice.
+    template <size_t N>
+    static constexpr bool IsValid(const StaticThermometer (&table)[N])
+    {
+        return isValidFrom(table, N, 0);
+    }
+
+private:
+    static constexpr uint8_t crc8Bits(uint8_t crc, uint8_t in, uint8_t bits)
+    {
+        return bits == 0 ? crc
+                         : crc8Bits((uint8_t)((crc >> 1) ^ (((crc ^ in) & 0x01) ? 0x8C : 0)), (uint8_t)(in >> 1),
+                                    bits - 1);
+    }
+
+    static constexpr bool isSameRom(const uint8_t *a, const uint8_t *b, uint8_t len = 8)
+    {
+        return len == 0 || (a[0] == b[0] && isSameRom(a + 1, b + 1, len - 1));
+    }
+
+    static constexpr bool isUniqueFrom(const StaticThermometer *table, size_t count, size_t i, size_t j)
+    {
+        return j >= count || (!isSameRom(table[i].Rom, table[j].Rom) && isUniqueFrom(table, count, i, j + 1));
+    }
+
+    static constexpr bool isValidFrom(const StaticThermometer *table, size_t count, size_t i)
+    {
+        return i >= count || (IsValidRom(table[i].Rom) && table[i].Name != nullptr &&
+                              table[i].Name[0] != 0 && isUniqueFrom(table, count, i, i + 1) &&
+                              isValidFrom(table, count, i + 1));
+    }
+};
+
+/// @brief Fixed wiring known at compile time, given to Async1WireMgr as its topology storage.
+/// @details The manager loads the table as it loads a saved topology: the thermometers are attached to their
+///          buses and polled at once, without a search. With SetDiscovery(false) the buses are never searched.
+///          Nothing is written: the table is in flash, the writes of the manager are ignored.
+///          Use STATIC_TOPOLOGY to declare it, the table is checked by the compiler.
+template <size_t N>
+class StaticTopology : public TopologyStorage
+{
+    static_assert(N <= MAX_THERMOMETERS, "Async1Wire: the static topology is larger than MAX_THERMOMETERS");
+
+public:
+    constexpr StaticTopology(const StaticThermometer (&table)[N]) : table(table) {}
+
+    bool Open(bool /*isWrite*/) override
+    {
+        index = 0;
+        return true;
+    }
+
+    bool Read(TopologyRecord &record) override
+    {
+        if (index >= N)
+        {
+            return false;
+        }
+        const StaticThermometer &t = table[index++];
+        memset(&record, 0, sizeof(record));
+        memcpy(record.Address.addr, t.Rom, sizeof(record.Address.addr));
+        strncpy(record.Name, t.Name, sizeof(record.Name) - 1);
+        record.Pin = t.Pin;
+        record.IsParasitePowered = t.IsParasitePowered;
+        return true;
+    }
+
+    bool Write(const TopologyRecord & /*record*/) override { return true; }
+    bool Close() override { return true; }
+
+    static constexpr size_t Size() { return N; }
+
+private:
+    const StaticThermometer (&table)[N];
+    size_t index = 0;
+};
+
+/// @brief Declare a fixed wiring: STATIC_TOPOLOGY(wiring, {pin, {ROM}, "name", parasite}, ...);
+/// @details A wrong CRC8, an unknown family (see StaticTopologyCheck::IsValidRom), a duplicate ROM or an empty name
+///          fail the build. The drivers of the families of FamilyDrivers.hpp are registered before Init().
+///          Then: OneWireMgr.SetTopologyStorage(&wiring); OneWireMgr.SetDiscovery(false);
+#define STATIC_TOPOLOGY(name, ...)                                                                                 \
+    static constexpr StaticThermometer name##Table[] = {__VA_ARGS__};                                              \
+    static_assert(StaticTopologyCheck::IsValid(name##Table),                                                       \
+                  "Async1Wire: " #name " has an invalid ROM (CRC8, family), a duplicate ROM or no name");          \
+    static StaticTopology<sizeof(name##Table) / sizeof(StaticThermometer)> name(name##Table)
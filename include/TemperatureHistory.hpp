@@ -0,0 +1,114 @@
+#pragma once
+#include <Arduino.h>
+
+// rolling windows of one history, see TemperatureHistory::SetWindow()
+#ifndef HISTORY_WINDOWS
+#define HISTORY_WINDOWS 2
+#endif
+
+typedef enum
+{
+    SAMPLE_OK,
+    SAMPLE_CRC_ERROR, // the read failed after the retries, Raw is 0
+    SAMPLE_LOST       // the device didn't answer, Raw is 0
+} SampleStatus;
+
+/// @brief One read of the thermometer.
+typedef struct
+{
+    uint32_t Sequence;  // 1, 2... : a gap between two reads means the samples were overwritten meanwhile
+    uint32_t Timestamp; // millis() of the conversion start
+    int16_t Raw;        // 1/16 degree: the 12 bit temperature register
+    uint8_t Status;     // SampleStatus
+} HistorySample;
+
+/// @brief Aggregates of the SAMPLE_OK samples of the last Window ms.
+typedef struct
+{
+    uint32_t Window; // ms
+    uint16_t Count;  // 0 - no samples, Min/Max/Mean are 0
+    float Min;       // degrees
+    float Max;
+    float Mean;
+} HistoryAggregate;
+
+/// @brief Ring of the last reads of one thermometer with rolling aggregates.
+/// @details The window ends at the conversion of the last sample and holds the samples still in the ring.
+///          Each window keeps the sum and count of its samples and two monotonic queues of their positions
+///          (increasing values for the minimum, decreasing for the maximum), so a sample is added and
+///          dropped in O(1) amortized and the aggregates are read in O(1), the ring is never scanned.
+///          Nothing is allocated: the storage is given by TemperatureHistoryBuffer<N>.
+///          Not thread safe: attached to a thermometer by Async1WireMgr::SetHistory(), it is written and read
+///          under the registry lock of the manager, use the manager to read it then.
+class TemperatureHistory
+{
+public:
+    /// @brief Set the length of the window. The samples in the ring are counted at once.
+    /// @param index - 0..HISTORY_WINDOWS-1
+    /// @param window - ms, 0 - not used
+    /// @return false if there is no such window.
+    bool SetWindow(uint8_t index, uint32_t window);
+
+    /// @brief Add the sample, the oldest one is overwritten when the ring is full.
+    void Add(uint32_t timestamp, int16_t raw, SampleStatus status);
+
+    /// @return false if there is no such window.
+    bool GetAggregate(uint8_t index, HistoryAggregate &aggregate);
+
+    /// @brief Copy the samples after the given one, the oldest first.
+    /// @details Pass the Sequence of the last sample read before (0 - from the oldest one) to stream the history.
+    /// @return number of samples copied.
+    uint16_t ReadSince(uint32_t sequence, HistorySample *samples, uint16_t size);
+
+    /// @brief Sequence of the last sample, 0 - none.
+    uint32_t LastSequence() { return lastSequence; }
+    uint16_t Capacity() { return capacity; }
+
+    // points to the storage of TemperatureHistoryBuffer: a copy would share it
+    TemperatureHistory(const TemperatureHistory &) = delete;
+    TemperatureHistory &operator=(const TemperatureHistory &) = delete;
+
+protected:
+    TemperatureHistory(HistorySample *samples, uint16_t *queues, uint16_t capacity);
+
+private:
+    typedef struct
+    {
+        uint32_t Length; // ms, 0 - not used
+        uint32_t Tail;   // sequence of the oldest sample in the window
+        int32_t Sum;     // of the Raw of the SAMPLE_OK samples
+        uint16_t Count;
+        uint16_t MinHead; // queues of positions in the ring: the front is the minimum/maximum of the window
+        uint16_t MinCount;
+        uint16_t MaxHead;
+        uint16_t MaxCount;
+    } Window;
+
+    HistorySample *samples;
+    uint16_t *queues; // [HISTORY_WINDOWS][2][capacity]: the minimum and maximum queues of each window
+    uint16_t capacity;
+    uint32_t lastSequence = 0;
+    Window windows[HISTORY_WINDOWS];
+
+    uint16_t positionOf(uint32_t sequence) { return (uint16_t)((sequence - 1) % capacity); }
+    uint32_t oldestSequence() { return lastSequence > capacity ? lastSequence - capacity + 1 : 1; }
+    uint16_t *minQueue(uint8_t index) { return queues + (2 * index) * capacity; }
+    uint16_t *maxQueue(uint8_t index) { return queues + (2 * index + 1) * capacity; }
+    void addToWindow(uint8_t index, uint32_t sequence);
+    void dropFromWindow(uint8_t index);
+};
+
+/// @brief TemperatureHistory with the storage of N samples.
+/// @details RAM: N * (sizeof(HistorySample) + 4 * HISTORY_WINDOWS) bytes, e.g. 960 bytes for N = 48.
+template <uint16_t N>
+class TemperatureHistoryBuffer : public TemperatureHistory
+{
+    static_assert(N > 0, "Async1Wire: the history needs at least one sample");
+
+public:
+    TemperatureHistoryBuffer() : TemperatureHistory(sampleStorage, queueStorage, N) {}
+
+private:
+    HistorySample sampleStorage[N];
+    uint16_t queueStorage[HISTORY_WINDOWS * 2 * N];
+};
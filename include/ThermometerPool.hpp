@@ -0,0 +1,205 @@
+#pragma once
+#include <atomic>
+#include <Arduino.h>
+#include "OneWireStats.hpp"
+#include "TemperatureHistory.hpp"
+#include "OneWireDriver.hpp"
+
+#ifndef MAX_THERMOMETERS
+#define MAX_THERMOMETERS 128
+#endif
+
+#ifndef MAX_ONEWIRE_BUSES
+#define MAX_ONEWIRE_BUSES 8
+#endif
+
+#define LENGTH_OF_NAME 32
+#define NO_THERMOMETER -1
+#define NO_BUS -1
+
+/// @brief Index of thermometer in the pool. It stays valid for the life of the pool.
+typedef int16_t ThermometerHandle;
+
+typedef union
+{
+    byte addr[8];
+    int64_t packedAddress;
+} Address1Wire;
+
+typedef struct
+{
+    char Name[LENGTH_OF_NAME];
+    Address1Wire Address;
+    byte Pin;
+    bool Status;
+    bool IsParasitePowered;
+    // configuration of the device as it was read last time
+    byte Resolution;  // 0 - not read yet
+    int8_t AlarmLow;  // TL register, whole degrees
+    int8_t AlarmHigh; // TH register, whole degrees
+    double Temperature;
+    uint32_t LastRead; // millis() of the last successful read
+} Thermometer;
+
+/// @brief Which temperature changes are posted as events.
+/// @details A change is posted when it is at least Deadband away from the last posted value
+///          (Deadband + Hysteresis, when it goes back in the opposite direction) and MinInterval is over
+///          since the last event. Heartbeat posts the temperature even without change.
+///          All zeros - every change of the rounded value is posted.
+typedef struct
+{
+    double Deadband;      // degrees
+    double Hysteresis;    // degrees
+    uint32_t MinInterval; // ms
+    uint32_t Heartbeat;   // ms, 0 - no heartbeat
+} TemperatureFilter;
+
+/// @brief Last temperature posted for the thermometer.
+typedef struct
+{
+    bool HasFilter;           // false - the global filter of the manager is used
+    TemperatureFilter Filter; // own filter of the thermometer
+    bool IsPosted;            // false - nothing posted since the device was found/restored
+    double Temperature;
+    uint32_t Time;    // millis()
+    int8_t Direction; // of the last posted change: 1 - up, -1 - down, 0 - unknown
+} PostedTemperature;
+
+/// @brief When the thermometer is read.
+typedef struct
+{
+    uint32_t Interval; // ms, 0 - the interval of the manager (SetTemperatureTimerInterval)
+    uint8_t Priority;  // devices with higher priority are read first
+    uint32_t Due;      // millis() of the next read
+    bool IsDue;        // the deadline is over, the device waits for the conversion
+    bool IsInCycle;    // the device is converted by the running cycle of its bus
+    uint8_t Failures;  // reads of the lost device failed in a row: it is probed with the backoff
+    bool HasRequest;   // RequestRead() waits for the next read of the device
+} ThermometerSchedule;
+
+/// @brief Configuration wanted for the device.
+/// @details Written to the device (scratchpad and EEPROM) only when the device differs from it.
+typedef struct
+{
+    uint8_t Resolution; // 0 - DEFAULT_RESOLUTION
+    bool HasAlarms;     // false - TL/TH of the device are kept
+    int8_t AlarmLow;
+    int8_t AlarmHigh;
+    bool IsPending;     // the device may differ: checked and written before the next conversion of its bus
+} ThermometerConfig;
+
+/// @brief Copy of the thermometer state which is safe to read from any task.
+typedef struct
+{
+    char Name[LENGTH_OF_NAME];
+    Address1Wire Address;
+    ThermometerHandle Handle;
+    byte Pin;
+    bool Status;
+    double Temperature;
+    uint32_t LastRead;
+} ThermometerSnapshot;
+
+/// @brief Fixed capacity storage of the thermometers.
+/// @details The records live in one array of MAX_THERMOMETERS and are addressed by handle.
+///          A record is never freed, so nothing is allocated on the heap: the ROM code and the name
+///          are indexed by chained hash tables of handles, each bus keeps a linked list of its devices.
+///          The pool is not thread safe. The manager calls it under its registry lock.
+///          The exception is the snapshot: each record has a copy of its state guarded by a sequence counter
+///          (seqlock). The writer (under the registry lock) calls Publish() after the changes, ReadSnapshot()
+///          can be called from any task without locks and retries when it meets a write.
+class ThermometerPool
+{
+public:
+    ThermometerPool();
+
+    /// @brief Add thermometer. The address must not be in the pool yet.
+    /// @return handle of the thermometer, NO_THERMOMETER if the pool is full.
+    ThermometerHandle Add(Address1Wire addr, const char *name);
+
+    /// @brief Find thermometer by ROM code.
+    /// @return handle of the thermometer, NO_THERMOMETER if not found.
+    ThermometerHandle Find(Address1Wire addr);
+
+    /// @brief Find thermometer by name.
+    /// @return handle of the thermometer, NO_THERMOMETER if not found.
+    ThermometerHandle FindByName(const char *name);
+
+    /// @brief Change name of the thermometer. The name is truncated to LENGTH_OF_NAME - 1 characters.
+    void Rename(ThermometerHandle h, const char *name);
+
+    /// @brief Move the thermometer to the end of the device list of the bus.
+    /// @details Nothing is done when the thermometer is on the bus already.
+    void AttachToBus(ThermometerHandle h, int8_t bus);
+
+    /// @brief Bus where the thermometer was found, NO_BUS - not found yet.
+    int8_t GetBus(ThermometerHandle h) { return records[h].Bus; }
+
+    /// @brief First device of the bus, NO_THERMOMETER - no devices.
+    ThermometerHandle FirstOnBus(int8_t bus) { return firstOnBus[bus]; }
+
+    /// @brief Next device on the same bus, NO_THERMOMETER - the last one.
+    ThermometerHandle NextOnBus(ThermometerHandle h) { return records[h].NextOnBus; }
+
+    Thermometer &Get(ThermometerHandle h) { return records[h].Data; }
+
+    /// @brief Search of the bus which found the thermometer last time.
+    uint32_t &SearchId(ThermometerHandle h) { return records[h].SearchId; }
+
+    /// @brief Filter and the last posted temperature.
+    PostedTemperature &Posted(ThermometerHandle h) { return records[h].Posted; }
+
+    ThermometerSchedule &Schedule(ThermometerHandle h) { return records[h].Schedule; }
+
+    SensorStats &Stats(ThermometerHandle h) { return records[h].Stats; }
+
+    /// @brief Configuration wanted for the device.
+    ThermometerConfig &Config(ThermometerHandle h) { return records[h].Config; }
+
+    /// @brief History of the reads, nullptr - not kept.
+    TemperatureHistory *&History(ThermometerHandle h) { return records[h].History; }
+
+    /// @brief Values of the last read decoded by the family driver, Count 0 - not read yet.
+    DeviceValues &Values(ThermometerHandle h) { return records[h].Values; }
+
+    /// @brief Copy the state of the thermometer to its snapshot.
+    void Publish(ThermometerHandle h);
+
+    /// @brief Read the snapshot of the thermometer. Lock free, can be called from any task.
+    /// @return false if there is no such handle.
+    bool ReadSnapshot(ThermometerHandle h, ThermometerSnapshot &snapshot);
+
+    int Count() { return count.load(std::memory_order_acquire); }
+    int Capacity() { return MAX_THERMOMETERS; }
+
+private:
+    typedef struct
+    {
+        Thermometer Data;
+        int8_t Bus;
+        uint32_t SearchId;
+        ThermometerConfig Config;
+        PostedTemperature Posted;
+        ThermometerSchedule Schedule;
+        SensorStats Stats;
+        TemperatureHistory *History;
+        DeviceValues Values;
+        ThermometerHandle NextOnBus;
+        ThermometerHandle NextByAddress;
+        ThermometerHandle NextByName;
+        std::atomic<uint32_t> Sequence; // odd - the snapshot is being written
+        ThermometerSnapshot Snapshot;
+    } ThermometerRecord;
+
+    ThermometerRecord records[MAX_THERMOMETERS];
+    std::atomic<int> count;
+    ThermometerHandle addressBuckets[MAX_THERMOMETERS];
+    ThermometerHandle nameBuckets[MAX_THERMOMETERS];
+    ThermometerHandle firstOnBus[MAX_ONEWIRE_BUSES];
+    ThermometerHandle lastOnBus[MAX_ONEWIRE_BUSES];
+
+    static uint32_t hashAddress(Address1Wire addr);
+    static uint32_t hashName(const char *name);
+    void linkName(ThermometerHandle h);
+    void unlinkName(ThermometerHandle h);
+};
@@ -0,0 +1,89 @@
+#pragma once
+#include <stdio.h>
+#include <Arduino.h>
+#include "ThermometerPool.hpp"
+#ifdef ARDUINO
+#include <nvs.h>
+#endif
+
+#define TOPOLOGY_MAGIC 0x31574F54 // "TOW1"
+#define TOPOLOGY_VERSION 1
+
+#ifndef TOPOLOGY_NVS_NAMESPACE
+#define TOPOLOGY_NVS_NAMESPACE "a1w_topology"
+#endif
+
+/// @brief One known thermometer, as it is kept by TopologyStorage.
+typedef struct
+{
+    Address1Wire Address;
+    char Name[LENGTH_OF_NAME];
+    byte Pin; // 0 - never found on a bus
+    uint8_t Resolution;
+    bool IsParasitePowered;
+} TopologyRecord;
+
+/// @brief Persistent storage of the known thermometers, see Async1WireMgr::SetTopologyStorage().
+/// @details The records are read and written one by one, so nothing has to be buffered.
+///          Open(true) starts a new set of records, Close() makes it the current one.
+class TopologyStorage
+{
+public:
+    virtual ~TopologyStorage() {}
+    /// @return false if there is nothing stored (read) or the storage can't be written.
+    virtual bool Open(bool isWrite) = 0;
+    /// @return false when there are no more records.
+    virtual bool Read(TopologyRecord &record) = 0;
+    virtual bool Write(const TopologyRecord &record) = 0;
+    /// @return false if the records written can't be committed.
+    virtual bool Close() = 0;
+};
+
+/// @brief Topology in a binary file: a header and the records.
+class TopologyStorageFile : public TopologyStorage
+{
+public:
+    TopologyStorageFile(const char *path) : path(path) {}
+    ~TopologyStorageFile() { Close(); }
+
+    bool Open(bool isWrite) override;
+    bool Read(TopologyRecord &record) override;
+    bool Write(const TopologyRecord &record) override;
+    bool Close() override;
+
+private:
+    typedef struct
+    {
+        uint32_t Magic;
+        uint16_t Version;
+        uint16_t RecordSize;
+    } FileHeader;
+
+    const char *path;
+    FILE *file = nullptr;
+    bool isWriting = false;
+    bool isFailed = false;
+};
+
+#ifdef ARDUINO
+/// @brief Topology in NVS: one blob per record and the number of records.
+class TopologyStorageNvs : public TopologyStorage
+{
+public:
+    TopologyStorageNvs(const char *nvsNamespace = TOPOLOGY_NVS_NAMESPACE) : nvsNamespace(nvsNamespace) {}
+
+    bool Open(bool isWrite) override;
+    bool Read(TopologyRecord &record) override;
+    bool Write(const TopologyRecord &record) override;
+    bool Close() override;
+
+private:
+    const char *nvsNamespace;
+    nvs_handle_t handle = 0;
+    bool isOpen = false;
+    bool isWriting = false;
+    bool isFailed = false;
+    uint32_t count = 0;
+    uint32_t index = 0;
+};
+#endif
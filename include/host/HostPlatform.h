@@ -0,0 +1,173 @@
+#pragma once
+// Minimal stand-ins for the Arduino/ESP-IDF/FreeRTOS surface used by Async1WireMgr.
+// Used only for host (Linux) builds: add "include/host" to the include path and
+// the manager, the bus backends and the examples compile unchanged.
+// Time is virtual: it advances only when bus operations, delay() or RunFor() spend it.
+#ifndef ARDUINO
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <math.h>
+#include <string>
+
+//------------------------------------------------------------------------------ Arduino core
+typedef uint8_t byte;
+typedef unsigned long ulong;
+
+#define HEX 16
+#define DEC 10
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+inline bool isHexadecimalDigit(int c) { return isxdigit(c) != 0; }
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+class String
+{
+public:
+    String(const char *s = "") : str(s == nullptr ? "" : s) {}
+    String(const std::string &s) : str(s) {}
+    explicit String(long long value, unsigned char base = 10);
+    const char *c_str() const { return str.c_str(); }
+    unsigned int length() const { return (unsigned int)str.length(); }
+    bool operator<(const String &rhs) const { return str < rhs.str; }
+    bool operator==(const String &rhs) const { return str == rhs.str; }
+    bool operator!=(const String &rhs) const { return str != rhs.str; }
+    String &operator+=(const String &rhs)
+    {
+        str += rhs.str;
+        return *this;
+    }
+    friend String operator+(const String &lhs, const String &rhs) { return String(lhs.str + rhs.str); }
+
+private:
+    std::string str;
+};
+
+class HostSerial
+{
+public:
+    void begin(unsigned long) {}
+    int printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+    void print(const char *s) { fputs(s, stdout); }
+    void print(double v) { ::printf("%.2f", v); }
+    void println(const char *s = "") { ::printf("%s\n", s); }
+    void println(double v) { ::printf("%.2f\n", v); }
+};
+extern HostSerial Serial;
+
+//------------------------------------------------------------------------------ FreeRTOS
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS 1
+#define pdFAIL 0
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+struct HostTimer;
+typedef HostTimer *TimerHandle_t;
+typedef void (*TimerCallbackFunction_t)(TimerHandle_t xTimer);
+typedef struct
+{
+    uint8_t storage[64];
+} StaticTimer_t;
+
+TimerHandle_t xTimerCreateStatic(const char *name, TickType_t period, UBaseType_t autoReload, void *timerId,
+                                 TimerCallbackFunction_t callback, StaticTimer_t *buffer);
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t ticksToWait);
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t ticksToWait);
+BaseType_t xTimerReset(TimerHandle_t timer, TickType_t ticksToWait);
+BaseType_t xTimerChangePeriod(TimerHandle_t timer, TickType_t period, TickType_t ticksToWait);
+BaseType_t xTimerDelete(TimerHandle_t timer, TickType_t ticksToWait);
+BaseType_t xTimerIsTimerActive(TimerHandle_t timer);
+void *pvTimerGetTimerID(TimerHandle_t timer);
+
+// The host build has no tasks: the work is done by the caller.
+typedef void *TaskHandle_t;
+typedef void *QueueHandle_t;
+#define tskNO_AFFINITY 0x7FFFFFFF
+
+// The host build is single threaded: mutexes are always free.
+typedef void *SemaphoreHandle_t;
+typedef struct
+{
+    uint8_t storage[8];
+} StaticSemaphore_t;
+inline SemaphoreHandle_t xSemaphoreCreateRecursiveMutexStatic(StaticSemaphore_t *buffer) { return buffer; }
+inline BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t mutex, TickType_t ticksToWait) { return pdTRUE; }
+inline BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t mutex) { return pdTRUE; }
+
+//------------------------------------------------------------------------------ ESP-IDF
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_NO_MEM 0x101
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_STATE 0x103
+#define ESP_ERR_TIMEOUT 0x107
+
+// the largest event data posted on the host: the copy of the loop is on the stack of the poster
+#ifndef HOST_EVENT_DATA_SIZE
+#define HOST_EVENT_DATA_SIZE 2048
+#endif
+
+typedef const char *esp_event_base_t;
+typedef void *esp_event_loop_handle_t;
+typedef void (*esp_event_handler_t)(void *handler_arg, esp_event_base_t event_base, int32_t event_id, void *event_data);
+typedef void *esp_event_handler_instance_t;
+
+typedef struct
+{
+    int32_t queue_size;
+    const char *task_name;
+    UBaseType_t task_priority;
+    uint32_t task_stack_size;
+    BaseType_t task_core_id;
+} esp_event_loop_args_t;
+
+#define ESP_EVENT_ANY_ID -1
+#define ESP_EVENT_DECLARE_BASE(id) extern esp_event_base_t const id
+#define ESP_EVENT_DEFINE_BASE(id) esp_event_base_t const id = #id
+
+esp_err_t esp_event_loop_create_default();
+esp_err_t esp_event_loop_create(const esp_event_loop_args_t *event_loop_args, esp_event_loop_handle_t *event_loop);
+esp_err_t esp_event_post(esp_event_base_t event_base, int32_t event_id, const void *event_data, size_t event_data_size,
+                         TickType_t ticks_to_wait);
+esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop, esp_event_base_t event_base, int32_t event_id,
+                            const void *event_data, size_t event_data_size, TickType_t ticks_to_wait);
+esp_err_t esp_event_handler_instance_register(esp_event_base_t event_base, int32_t event_id,
+                                              esp_event_handler_t event_handler, void *event_handler_arg,
+                                              esp_event_handler_instance_t *instance);
+esp_err_t esp_event_handler_instance_register_with(esp_event_loop_handle_t event_loop, esp_event_base_t event_base,
+                                                   int32_t event_id, esp_event_handler_t event_handler,
+                                                   void *event_handler_arg, esp_event_handler_instance_t *instance);
+int64_t esp_timer_get_time();
+
+//------------------------------------------------------------------------------ Host control
+class HostPlatform
+{
+public:
+    /// @brief Current virtual time in microseconds.
+    static uint64_t NowMicros();
+    /// @brief Move virtual time forward without firing timers (bus time, busy waits).
+    static void Advance(uint64_t us);
+    /// @brief Move virtual time forward by ms, firing every timer that expires on the way.
+    static void RunFor(unsigned long ms);
+    /// @brief Number of events posted since start (all loops).
+    static uint32_t PostedEvents();
+    /// @brief The handlers are busy for ms from now: a post waits until then or fails with ESP_ERR_TIMEOUT
+    ///        when its ticks_to_wait are over first (a slow consumer, all loops).
+    static void StallEventLoop(unsigned long ms);
+};
+#endif
@@ -0,0 +1,3 @@
+#pragma once
+// Host build stand-in, see HostPlatform.h
+#include "HostPlatform.h"
@@ -1,8 +1,10 @@
 #include "Async1WireMgr.hpp"
 #include <esp_event.h>
 #include <esp_err.h>
+#include <new>
+#include <stddef.h>
 
-#include <DallasTemperature.h>
+#include "DS18x20.hpp"
 
 char Async1WireMgr::addrPrinted[SIZE_OF_ADDRESS_PRINTED + 1];
 
@@ -14,354 +16,2296 @@ Async1WireMgr::Async1WireMgr(esp_event_loop_handle_t eventLoop)
         esp_event_loop_create_default();
     }
 
+    // one-shot: armed to the earliest deadline of the thermometers
+    // the manager is the ID of its timers: each instance has its own cadence
     temperatureLoopTimer = xTimerCreateStatic("TemperatureLoopTimer", pdMS_TO_TICKS(temperatureTimerInterval),
-                                              pdTRUE, NULL, onTemperatureLoopTimer, &temperatureLoopBuffer);
+                                              pdFALSE, this, onTemperatureLoopTimer, &temperatureLoopBuffer);
+    statsTimer = xTimerCreateStatic("StatsTimer", 1, pdTRUE, this, onStatsTimer, &statsBuffer);
+    searchTimer = xTimerCreateStatic("SearchTimer", pdMS_TO_TICKS(TOPOLOGY_SEARCH_DELAY), pdFALSE, this, onSearchTimer,
+                                     &searchBuffer);
+    postTimer = xTimerCreateStatic("PostTimer", pdMS_TO_TICKS(POST_RETRY_PERIOD), pdFALSE, this, onPostTimer,
+                                   &postBuffer);
+    lock = xSemaphoreCreateRecursiveMutexStatic(&lockBuffer);
+    outboxLock = xSemaphoreCreateRecursiveMutexStatic(&outboxLockBuffer);
+    worker.Manager = this;
+    worker.Queue = NULL;
+    worker.Task = NULL;
+#ifdef ARDUINO
+    worker.Queue = xQueueCreateStatic(WORK_QUEUE_LENGTH, sizeof(WorkItem), workQueueStorage, &workQueueBuffer);
+#endif
 }
 
 void Async1WireMgr::Init()
 {
     if (!isInitialized)
     {
+#ifdef ARDUINO
+        xTaskCreate(workerLoop, "Async1Wire", WORKER_TASK_STACK_SIZE, &worker, WORKER_TASK_PRIORITY, &worker.Task);
+#endif
+        for (int i = 0; i < MAX_ONEWIRE_BUSES; i++)
+        {
+            OneWireBusUnit *unit = getBusAt(i);
+            if (unit != nullptr)
+            {
+                unit->Wire->begin(unit->Pin);
+                startBusTask(*unit);
+            }
+        }
+        isInitialized = true;
+        if (loadTopology())
+        {
+            // warm start: the known devices are checked and polled at once, the search is done later
+            for (int i = 0; i < MAX_ONEWIRE_BUSES; i++)
+            {
+                OneWireBusUnit *unit = getBusAt(i);
+                if (unit != nullptr)
+                {
+                    postWork(unit, WORK_VERIFY);
+                }
+            }
+            postWork(nullptr, WORK_START_CYCLE);
+            if (isDiscovery)
+            {
+                requestSearch();
+                xTimerChangePeriod(searchTimer, pdMS_TO_TICKS(TOPOLOGY_SEARCH_DELAY), 0);
+            }
+            return;
+        }
+    }
+    if (isDiscovery)
+    {
+        SearchDevices();
+    }
+    // the devices found are due now: the dispatch arms the timer to the next deadline
+    postWork(nullptr, WORK_START_CYCLE);
+}
+
+bool Async1WireMgr::Add1Wire(byte pin, OneWireBus *bus)
+{
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    OneWireBusUnit *existing = nullptr;
+    for (int i = 0; i < numbBuses; i++)
+    {
+        if (oneWireCollection[i].Pin == pin)
+        {
+            existing = &oneWireCollection[i];
+        }
+    }
+    if ((existing != nullptr && existing->Wire != nullptr) || (existing == nullptr && numbBuses >= MAX_ONEWIRE_BUSES))
+    {
+        xSemaphoreGiveRecursive(lock);
+        return false;
+    }
+    // removed bus keeps its unit: the timer, the lock and the device list are reused
+    bool isNew = (existing == nullptr);
+    OneWireBusUnit &unit = isNew ? oneWireCollection[numbBuses] : *existing;
+    if (isNew)
+    {
+        unit.Pin = pin;
+        unit.Index = (int8_t)numbBuses;
+        unit.SearchCount = 0;
+        unit.DueCount = 0;
+        memset(&unit.Stats, 0, sizeof(unit.Stats));
+        unit.Batch.Count = 0;
+        unit.ConfigPending = false;
+        unit.CollectTimer =
+            xTimerCreateStatic("CollectTimer", 1, pdFALSE, &unit, onCollectTimer, &unit.CollectTimerBuffer);
+        unit.Lock = xSemaphoreCreateRecursiveMutexStatic(&unit.LockBuffer);
+        unit.Worker.Manager = this;
+        unit.Worker.Queue = NULL;
+        unit.Worker.Task = NULL;
+    }
+    unit.OwnsWire = (bus == nullptr);
+    if (bus == nullptr)
+    {
+        bus = new (unit.WireStorage) DefaultOneWireBus();
+    }
+    unit.Mode = CONVERSION_BROADCAST;
+    unit.Read = READ_ALL;
+    unit.FullReadCycles = ALARM_FULL_READ_CYCLES;
+    unit.CyclesToFullRead = 0;
+    unit.IsParasitePowered = false;
+    unit.Phase = BUS_IDLE;
+    unit.CycleDevice = NO_THERMOMETER;
+    unit.IsSearchRequested = false;
+    unit.IsSearching = false;
+    unit.IsSuspended = false;
+    unit.HasOwnTask = false;
+    unit.Core = tskNO_AFFINITY;
+    unit.Priority = WORKER_TASK_PRIORITY;
+    unit.Wire = bus;
+    if (isNew)
+    {
+        numbBuses++;
+    }
+    xSemaphoreGiveRecursive(lock);
+
+    if (isInitialized)
+    {
+        bus->begin(pin);
+    }
+    return true;
+}
+
+bool Async1WireMgr::Remove1Wire(byte pin)
+{
+    OneWireBusUnit *unit = getBus(pin);
+    if (unit == nullptr)
+    {
+        return false;
+    }
+    xSemaphoreTakeRecursive(unit->Lock, portMAX_DELAY);
+    xTimerStop(unit->CollectTimer, portMAX_DELAY);
+    unit->Phase = BUS_IDLE;
+    if (unit->OwnsWire)
+    {
+        unit->Wire->~OneWireBus();
+    }
+    unit->Wire = nullptr;
+#ifdef ARDUINO
+    if (unit->Worker.Queue != NULL)
+    {
+        postWork(unit, WORK_EXIT);
+    }
+#endif
+    xSemaphoreGiveRecursive(unit->Lock);
+    return true;
+}
+
+bool Async1WireMgr::SetConversionMode(byte pin, ConversionMode mode)
+{
+    OneWireBusUnit *unit = getBus(pin);
+    if (unit == nullptr)
+    {
+        return false;
+    }
+    // the worker reads the mode at the start of a cycle, with the lock of the bus
+    xSemaphoreTakeRecursive(unit->Lock, portMAX_DELAY);
+    unit->Mode = mode;
+    xSemaphoreGiveRecursive(unit->Lock);
+    return true;
+}
+
+bool Async1WireMgr::SetReadMode(byte pin, ReadMode mode, uint16_t fullReadCycles)
+{
+    OneWireBusUnit *unit = getBus(pin);
+    if (unit == nullptr)
+    {
+        return false;
+    }
+    // the worker counts the cycles to the full read with the lock of the bus
+    xSemaphoreTakeRecursive(unit->Lock, portMAX_DELAY);
+    unit->Read = mode;
+    unit->FullReadCycles = fullReadCycles;
+    unit->CyclesToFullRead = 0;
+    xSemaphoreGiveRecursive(unit->Lock);
+    return true;
+}
+
+bool Async1WireMgr::SetAlarmThresholds(Address1Wire addr, int8_t low, int8_t high)
+{
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    ThermometerHandle h = pool.Find(addr);
+    // the other families have no alarms
+    if (h != NO_THERMOMETER && !DS18x20::IsFamily(addr.addr[0]))
+    {
+        h = NO_THERMOMETER;
+    }
+    if (h != NO_THERMOMETER)
+    {
+        ThermometerConfig &config = pool.Config(h);
+        config.HasAlarms = true;
+        config.AlarmLow = low;
+        config.AlarmHigh = high;
+        setConfigPending(h);
+    }
+    xSemaphoreGiveRecursive(lock);
+    return h != NO_THERMOMETER;
+}
+
+bool Async1WireMgr::SetResolution(Address1Wire addr, uint8_t resolution)
+{
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    ThermometerHandle h = pool.Find(addr);
+    if (h != NO_THERMOMETER && !DS18x20::IsFamily(addr.addr[0]))
+    {
+        h = NO_THERMOMETER;
+    }
+    if (h != NO_THERMOMETER)
+    {
+        pool.Config(h).Resolution = resolution == 0 ? 0 : constrain(resolution, 9, 12);
+        setConfigPending(h);
+    }
+    xSemaphoreGiveRecursive(lock);
+    return h != NO_THERMOMETER;
+}
+
+void Async1WireMgr::setConfigPending(ThermometerHandle h)
+{
+    pool.Config(h).IsPending = true;
+    if (pool.GetBus(h) != NO_BUS)
+    {
+        oneWireCollection[pool.GetBus(h)].ConfigPending = true;
+    }
+}
+
+bool Async1WireMgr::isConfigDifferent(ThermometerHandle h)
+{
+    const Thermometer &t = pool.Get(h);
+    const ThermometerConfig &config = pool.Config(h);
+    if (t.Resolution == 0)
+    {
+        // not read yet: the first read tells
+        return false;
+    }
+    uint8_t resolution = config.Resolution != 0 ? config.Resolution : DEFAULT_RESOLUTION;
+    // DS18S20 has no configuration register
+    bool hasResolution = t.Address.addr[0] != DS18S20MODEL;
+    return (hasResolution && t.Resolution != resolution) ||
+           (config.HasAlarms && (t.AlarmLow != config.AlarmLow || t.AlarmHigh != config.AlarmHigh));
+}
+
+void Async1WireMgr::updateDeviceConfig(ThermometerHandle h, const uint8_t *scratchPad)
+{
+    // each scratchpad read refreshes the cache of the device configuration: a device reset or replaced
+    // is written again
+    Thermometer &t = pool.Get(h);
+    t.Resolution = DS18x20::GetResolution(t.Address.addr, scratchPad);
+    t.AlarmLow = (int8_t)scratchPad[DS18X20_LOW_ALARM_TEMP];
+    t.AlarmHigh = (int8_t)scratchPad[DS18X20_HIGH_ALARM_TEMP];
+    if (isConfigDifferent(h))
+    {
+        setConfigPending(h);
+    }
+}
+
+bool Async1WireMgr::SetTemperatureFilter(Address1Wire addr, const TemperatureFilter *filter)
+{
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    ThermometerHandle h = pool.Find(addr);
+    if (h != NO_THERMOMETER)
+    {
+        PostedTemperature &posted = pool.Posted(h);
+        posted.HasFilter = (filter != nullptr);
+        if (filter != nullptr)
+        {
+            posted.Filter = *filter;
+        }
+    }
+    xSemaphoreGiveRecursive(lock);
+    return h != NO_THERMOMETER;
+}
+
+bool Async1WireMgr::SetThermometerInterval(Address1Wire addr, uint32_t interval, uint8_t priority)
+{
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    ThermometerHandle h = pool.Find(addr);
+    if (h != NO_THERMOMETER)
+    {
+        ThermometerSchedule &s = pool.Schedule(h);
+        s.Interval = interval;
+        s.Priority = priority;
+        schedule(h, millis());
+        armScheduler();
+    }
+    xSemaphoreGiveRecursive(lock);
+    return h != NO_THERMOMETER;
+}
+
+bool Async1WireMgr::RequestRead(Address1Wire addr, const ReadRequest &request)
+{
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    ThermometerHandle h = pool.Find(addr);
+    xSemaphoreGiveRecursive(lock);
+    return h != NO_THERMOMETER && requestRead(h, NO_BUS, request);
+}
+
+bool Async1WireMgr::RequestRead(const char *name, const ReadRequest &request)
+{
+    ThermometerHandle h = FindThermometer(name);
+    return h != NO_THERMOMETER && requestRead(h, NO_BUS, request);
+}
+
+bool Async1WireMgr::RequestBusRead(byte pin, const ReadRequest &request)
+{
+    OneWireBusUnit *unit = getBus(pin);
+    return unit != nullptr && requestRead(NO_THERMOMETER, unit->Index, request);
+}
+
+bool Async1WireMgr::requestRead(ThermometerHandle h, int8_t bus, const ReadRequest &request)
+{
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    if (h != NO_THERMOMETER)
+    {
+        bus = pool.GetBus(h);
+    }
+    // a thermometer given by name or loaded from the storage has no bus until it is found
+    ThermometerHandle first = bus == NO_BUS ? NO_THERMOMETER : (h != NO_THERMOMETER ? h : pool.FirstOnBus(bus));
+    OneWireBusUnit *unit = first == NO_THERMOMETER ? nullptr : &oneWireCollection[bus];
+    PendingRead *pending = (unit == nullptr || unit->Wire == nullptr) ? nullptr : allocReadRequest();
+    if (pending != nullptr)
+    {
+        pending->Handle = h;
+        pending->Bus = bus;
+        pending->Request = request;
+        // the deadlines are kept: the device is just added to the next cycle of its bus
+        ThermometerHandle d = first;
+        for (; d != NO_THERMOMETER; d = (h != NO_THERMOMETER) ? NO_THERMOMETER : pool.NextOnBus(d))
+        {
+            ThermometerSchedule &s = pool.Schedule(d);
+            if (h != NO_THERMOMETER)
+            {
+                s.HasRequest = true;
+                if (s.IsInCycle)
+                {
+                    // the running conversion serves the request
+                    continue;
+                }
+            }
+            if (!s.IsDue)
+            {
+                s.IsDue = true;
+                unit->DueCount++;
+            }
+        }
+    }
+    xSemaphoreGiveRecursive(lock);
+    if (pending != nullptr)
+    {
+        postWork(unit, WORK_START_BUS);
+    }
+    return pending != nullptr;
+}
+
+PendingRead *Async1WireMgr::allocReadRequest()
+{
+    for (int i = 0; i < READ_REQUEST_SLOTS; i++)
+    {
+        if (!readRequests[i].IsUsed)
+        {
+            memset(&readRequests[i], 0, sizeof(PendingRead));
+            readRequests[i].IsUsed = true;
+            numbReadRequests++;
+            return &readRequests[i];
+        }
+    }
+    return nullptr;
+}
+
+void Async1WireMgr::completeDeviceReads(OneWireBusUnit &unit, ThermometerHandle h, bool isRead)
+{
+    PendingRead done[READ_REQUEST_SLOTS];
+    int count = 0;
+    ReadResult result;
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    pool.Schedule(h).HasRequest = false;
+    for (int i = 0; i < READ_REQUEST_SLOTS; i++)
+    {
+        if (readRequests[i].IsUsed && readRequests[i].Handle == h)
+        {
+            done[count++] = readRequests[i];
+            readRequests[i].IsUsed = false;
+            numbReadRequests--;
+        }
+    }
+    result.Handle = h;
+    result.Pin = unit.Pin;
+    result.IsRead = isRead;
+    result.Temperature = pool.Get(h).Temperature;
+    xSemaphoreGiveRecursive(lock);
+    for (int i = 0; i < count; i++)
+    {
+        result.Token = done[i].Request.Token;
+        finishRead(done[i], result);
+    }
+}
+
+void Async1WireMgr::completeReads(OneWireBusUnit &unit)
+{
+    if (numbReadRequests == 0)
+    {
+        return;
+    }
+    PendingRead done[READ_REQUEST_SLOTS];
+    ReadResult results[READ_REQUEST_SLOTS];
+    int count = 0;
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    for (int i = 0; i < READ_REQUEST_SLOTS; i++)
+    {
+        PendingRead &pending = readRequests[i];
+        if (!pending.IsUsed || pending.Bus != unit.Index)
+        {
+            continue;
+        }
+        ReadResult &result = results[count];
+        result.Token = pending.Request.Token;
+        result.Handle = pending.Handle;
+        result.Pin = unit.Pin;
+        if (pending.Handle == NO_THERMOMETER)
+        {
+            // the bus request is over with the cycle which claimed it
+            if (!pending.IsClaimed)
+            {
+                continue;
+            }
+            result.IsRead = !unit.IsSuspended;
+            result.Temperature = 0;
+        }
+        else
+        {
+            // a read completes its requests: the device left the cycle without the read (the cycle was aborted)
+            ThermometerSchedule &s = pool.Schedule(pending.Handle);
+            if (s.IsDue || s.IsInCycle)
+            {
+                continue;
+            }
+            s.HasRequest = false;
+            result.IsRead = false;
+            result.Temperature = pool.Get(pending.Handle).Temperature;
+        }
+        done[count++] = pending;
+        pending.IsUsed = false;
+        numbReadRequests--;
+    }
+    xSemaphoreGiveRecursive(lock);
+    for (int i = 0; i < count; i++)
+    {
+        finishRead(done[i], results[i]);
+    }
+}
+
+void Async1WireMgr::finishRead(const PendingRead &pending, const ReadResult &result)
+{
+    const ReadRequest &request = pending.Request;
+    if (request.Callback != nullptr)
+    {
+        request.Callback(result, request.Arg);
+    }
+    if (request.IsEvent)
+    {
+        postEvent(ONEWIRE_EVENT_READ, &result, sizeof(ReadResult));
+    }
+#ifdef ARDUINO
+    if (request.Notify != NULL)
+    {
+        xTaskNotifyGive(request.Notify);
+    }
+#endif
+}
+
+bool Async1WireMgr::SetBusTask(byte pin, BaseType_t core, UBaseType_t priority)
+{
+    OneWireBusUnit *unit = getBus(pin);
+    if (unit == nullptr)
+    {
+        return false;
+    }
+    unit->HasOwnTask = true;
+    unit->Core = core;
+    unit->Priority = priority;
+    if (isInitialized)
+    {
+        startBusTask(*unit);
+    }
+    return true;
+}
+
+void Async1WireMgr::SearchDevices()
+{
+    if (isInitialized)
+    {
+#ifdef ARDUINO
+        TaskHandle_t caller = xTaskGetCurrentTaskHandle();
+        int pending = 0;
+#endif
+        for (int i = 0; i < MAX_ONEWIRE_BUSES; i++)
+        {
+            OneWireBusUnit *unit = getBusAt(i);
+            if (unit == nullptr)
+            {
+                continue;
+            }
+#ifdef ARDUINO
+            if (unit->Worker.Queue != NULL)
+            {
+                postWork(unit, WORK_SEARCH, caller);
+                pending++;
+                continue;
+            }
+#endif
+            runBusWork(*unit, WORK_SEARCH);
+        }
+#ifdef ARDUINO
+        // buses with own worker are searched at the same time
+        while (pending-- > 0)
+        {
+            ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+        }
+#endif
+    }
+}
+
+bool Async1WireMgr::loadTopology()
+{
+    if (topologyStorage == nullptr || !topologyStorage->Open(false))
+    {
+        return false;
+    }
+    bool isOnBus = false;
+    uint32_t now = millis();
+    TopologyRecord record;
+    while (topologyStorage->Read(record))
+    {
+        ThermometerEvent changes;
+        changes.Event = UNIT_ADDED;
+        changes.ErrorCode = UNIT_OK;
+        changes.Address = record.Address;
+        changes.Pin = record.Pin;
+        changes.OldName[0] = 0;
+        record.Name[LENGTH_OF_NAME - 1] = 0;
+        strncpy(changes.Name, record.Name, sizeof(changes.Name));
+
+        xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+        if (pool.Find(record.Address) != NO_THERMOMETER)
+        {
+            xSemaphoreGiveRecursive(lock);
+            continue;
+        }
+        ThermometerHandle h = pool.Add(record.Address, record.Name);
+        if (h == NO_THERMOMETER)
+        {
+            xSemaphoreGiveRecursive(lock);
+            break;
+        }
+        Thermometer &t = pool.Get(h);
+        t.Pin = record.Pin;
+        t.Status = false; // until it is checked on the bus
+        t.IsParasitePowered = record.IsParasitePowered;
+        t.Resolution = record.Resolution;
+        t.Temperature = 0;
+        for (int i = 0; i < numbBuses; i++)
+        {
+            OneWireBusUnit &unit = oneWireCollection[i];
+            if (unit.Wire != nullptr && unit.Pin == record.Pin)
+            {
+                pool.AttachToBus(h, unit.Index);
+                unit.IsParasitePowered = unit.IsParasitePowered || record.IsParasitePowered;
+                isOnBus = true;
+            }
+        }
+        schedule(h, now);
+        pool.Publish(h);
+        xSemaphoreGiveRecursive(lock);
+        notifyThermometerChanges(&changes);
+    }
+    topologyStorage->Close();
+    return isOnBus;
+}
+
+void Async1WireMgr::verifyBus(OneWireBusUnit &unit)
+{
+    // Match ROM scratchpad read of each known device instead of the search
+    for (ThermometerHandle h = nextOnBus(unit, NO_THERMOMETER); h != NO_THERMOMETER; h = nextOnBus(unit, h))
+    {
+        Thermometer &t = pool.Get(h);
+        OneWireDriver *driver = driverOf(h);
+        uint8_t data[DRIVER_DATA_SIZE];
+        ScratchPadStatus status = driver->Read(unit.Wire, t.Address.addr, data);
+        for (uint8_t retry = 0; status == SCRATCHPAD_CRC_ERROR && retry < readRetries; retry++)
+        {
+            status = driver->Read(unit.Wire, t.Address.addr, data);
+        }
+        if (status != SCRATCHPAD_OK)
+        {
+            // not found: the background search decides
+            continue;
+        }
+        xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+        t.Status = true;
+        if (DS18x20::IsFamily(t.Address.addr[0]))
+        {
+            // a different configuration is written before the first conversion
+            updateDeviceConfig(h, data);
+        }
+        pool.Publish(h);
+        xSemaphoreGiveRecursive(lock);
+    }
+}
+
+void Async1WireMgr::saveTopology()
+{
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    bool isChanged = isTopologyChanged;
+    isTopologyChanged = false;
+    xSemaphoreGiveRecursive(lock);
+    if (!isChanged || topologyStorage == nullptr)
+    {
+        return;
+    }
+    bool isSaved = topologyStorage->Open(true);
+    for (ThermometerHandle h = 0; isSaved && h < pool.Count(); h++)
+    {
+        TopologyRecord record;
+        memset(&record, 0, sizeof(record));
+        xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+        Thermometer &t = pool.Get(h);
+        record.Address = t.Address;
+        strncpy(record.Name, t.Name, sizeof(record.Name));
+        record.Pin = t.Pin;
+        record.Resolution = t.Resolution;
+        record.IsParasitePowered = t.IsParasitePowered;
+        xSemaphoreGiveRecursive(lock);
+        isSaved = topologyStorage->Write(record);
+    }
+    isSaved = topologyStorage->Close() && isSaved;
+    if (!isSaved)
+    {
+        Serial.printf("Async1Wire: topology is not saved\n");
+    }
+}
+
+void Async1WireMgr::searchBus(OneWireBusUnit &unit)
+{
+    startSearch(unit);
+    while (!searchStep(unit, UINT16_MAX))
+    {
+    }
+
+    // the search has released the strong pullup of the device being converted: convert it again
+    if (unit.Phase == BUS_CONVERTING_DEVICE)
+    {
+        Thermometer &t = pool.Get(unit.CycleDevice);
+        OneWireDriver *driver = driverOf(unit.CycleDevice);
+        driver->StartConversion(unit.Wire, t.Address.addr, t.IsParasitePowered);
+        unit.ConversionStart = micros();
+        armCollectTimer(unit, driver->ConversionTimeMicros(t.Status ? t.Resolution : 0));
+    }
+}
+
+void Async1WireMgr::startSearch(OneWireBusUnit &unit)
+{
+    uint32_t start = micros();
+    unit.SearchCount++;
+    // the devices found by one search are due at the same time: they are converted by one cycle
+    unit.SearchTime = millis();
+    unit.IsParasitePowered = DS18x20::ReadPowerSupply(unit.Wire, nullptr);
+    unit.Wire->reset_search();
+    unit.Wire->get_search_state(unit.SearchState);
+    unit.SearchMicros = micros() - start;
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    unit.IsSearching = true;
+    unit.IsSearchRequested = false;
+    xSemaphoreGiveRecursive(lock);
+}
+
+bool Async1WireMgr::searchStep(OneWireBusUnit &unit, uint16_t devices)
+{
+    OneWireBus *oneWire = unit.Wire;
+    uint32_t start = micros();
+    if (!oneWire->reset())
+    {
+        // nobody answers: the devices are not lost one by one, the search is dropped
+        setBusSuspended(unit, true);
+        xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+        unit.IsSearching = false;
+        xSemaphoreGiveRecursive(lock);
+        return true;
+    }
+    setBusSuspended(unit, false);
+    // Step1: find the next devices. Each device is handled as soon as it is found: the position in the tree
+    //        is kept by the unit between the steps, an alarm search may run in between
+    oneWire->set_search_state(unit.SearchState);
+    bool isOver = false;
+    Address1Wire deviceAddress;
+    for (uint16_t i = 0; i < devices && !isOver; i++)
+    {
+        if (!oneWire->search(deviceAddress.addr))
+        {
+            isOver = true;
+            break;
+        }
+        if (OneWireBus::crc8(deviceAddress.addr, 7) != deviceAddress.addr[7])
+        {
+            ThermometerEvent tc;
+            tc.Address = deviceAddress;
+            tc.Event = UNIT_ERROR;
+            tc.Name[0] = 0;
+            tc.OldName[0] = 0;
+            tc.Pin = unit.Pin;
+            tc.ErrorCode = UNIT_CRC_ERROR;
+            xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+            ThermometerHandle h = pool.Find(deviceAddress);
+            if (h != NO_THERMOMETER)
+            {
+                strncpy(tc.Name, pool.Get(h).Name, sizeof(tc.Name));
+            }
+            xSemaphoreGiveRecursive(lock);
+            notifyThermometerChanges(&tc);
+            continue;
+        }
+        // Step2: detect device found
+        switch (DetectFamily(deviceAddress))
+        {
+        case ONEWIRE_DSTHERMO:
+        case ONEWIRE_FAMILY_DRIVER:
+            addFoundDevice(unit, deviceAddress, unit.SearchTime);
+            break;
+        default:
+            break;
+        }
+    }
+    oneWire->get_search_state(unit.SearchState);
+    unit.SearchMicros += micros() - start;
+    if (!isOver)
+    {
+        return false;
+    }
+
+    // Step3: devices of the bus which were not found
+    // one device per scan: its event is posted without the lock, the next scan skips the devices marked lost
+    bool isLost = true;
+    while (isLost)
+    {
+        ThermometerEvent changes;
+        isLost = false;
+        xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+        for (ThermometerHandle h = pool.FirstOnBus(unit.Index); h != NO_THERMOMETER && !isLost; h = pool.NextOnBus(h))
+        {
+            Thermometer &t = pool.Get(h);
+            if (t.Status && pool.SearchId(h) != unit.SearchCount)
+            {
+                isLost = true;
+                t.Status = false;
+                quarantine(h);
+                pool.Publish(h);
+                pool.Stats(h).Lost++;
+                unit.Stats.Lost++;
+                changes.Event = UNIT_CONNECTION_LOST;
+                changes.ErrorCode = UNIT_OK;
+                strncpy(changes.Name, t.Name, sizeof(changes.Name));
+                changes.Address = t.Address;
+                changes.Pin = t.Pin;
+                changes.OldName[0] = 0;
+            }
+        }
+        xSemaphoreGiveRecursive(lock);
+        if (isLost)
+        {
+            notifyThermometerChanges(&changes);
+        }
+    }
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    unit.IsSearching = false;
+    unit.Stats.Searches++;
+    AddLatency(unit.Stats.Search, unit.SearchMicros);
+    bool isChanged = isTopologyChanged;
+    xSemaphoreGiveRecursive(lock);
+    if (isChanged)
+    {
+        postWork(nullptr, WORK_SAVE);
+    }
+    return true;
+}
+
+void Async1WireMgr::StartSearch()
+{
+    requestSearch();
+    postWork(nullptr, WORK_SEARCH_ALL);
+}
+
+void Async1WireMgr::requestSearch()
+{
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    for (int i = 0; i < numbBuses; i++)
+    {
+        // a search already running is not restarted
+        oneWireCollection[i].IsSearchRequested = !oneWireCollection[i].IsSearching;
+    }
+    xSemaphoreGiveRecursive(lock);
+}
+
+void Async1WireMgr::searchIdleBuses()
+{
+    bool isActive = false;
+    for (int i = 0; i < MAX_ONEWIRE_BUSES; i++)
+    {
+        OneWireBusUnit *unit = getBusAt(i);
+        if (unit == nullptr)
+        {
+            continue;
+        }
+        xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+        bool isToStep = unit->IsSearching || unit->IsSearchRequested;
+        xSemaphoreGiveRecursive(lock);
+        if (!isToStep)
+        {
+            continue;
+        }
+        isActive = true;
+        if (unit->Worker.Queue != NULL)
+        {
+            postWork(unit, WORK_SEARCH_STEP);
+        }
+        else
+        {
+            runBusWork(*unit, WORK_SEARCH_STEP);
+        }
+    }
+    if (isActive)
+    {
+        // the last step is checked by one more tick
+        xTimerChangePeriod(searchTimer, pdMS_TO_TICKS(SEARCH_STEP_PERIOD), 0);
+    }
+}
+
+void Async1WireMgr::addFoundDevice(OneWireBusUnit &unit, Address1Wire addr, uint32_t due)
+{
+    OneWireBus *oneWire = unit.Wire;
+    bool isThermometer = DS18x20::IsFamily(addr.addr[0]);
+    uint8_t data[DRIVER_DATA_SIZE];
+    bool isParasitePowered = isThermometer && DS18x20::ReadPowerSupply(oneWire, addr.addr);
+    // the configuration is not written here: the read fills the cache, the differences are written
+    // before the next conversion of the bus
+    uint8_t resolution = 0;
+    bool isConnected = findDriver(addr.addr[0])->Read(oneWire, addr.addr, data) == SCRATCHPAD_OK;
+    if (isConnected && isThermometer)
+    {
+        resolution = DS18x20::GetResolution(addr.addr, data);
+    }
+
+    ThermometerEvent changes;
+    changes.Address = addr;
+    changes.Pin = unit.Pin;
+    changes.OldName[0] = 0;
+    changes.ErrorCode = UNIT_OK;
+
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    ThermometerHandle h = pool.Find(addr);
+    bool isNew = (h == NO_THERMOMETER);
+    if (isNew)
+    {
+        char name[LENGTH_OF_NAME];
+        snprintf(name, sizeof(name), "T%llx", (unsigned long long)addr.packedAddress);
+        h = pool.Add(addr, name);
+        if (h == NO_THERMOMETER)
+        {
+            xSemaphoreGiveRecursive(lock);
+            changes.Name[0] = 0;
+            changes.Event = UNIT_ERROR;
+            changes.ErrorCode = UNIT_NO_SPACE;
+            notifyThermometerChanges(&changes);
+            return;
+        }
+    }
+    Thermometer &t = pool.Get(h);
+    bool isRestored = !isNew && !t.Status;
+    if (isNew || pool.GetBus(h) != unit.Index || t.IsParasitePowered != isParasitePowered ||
+        (resolution != 0 && t.Resolution != resolution))
+    {
+        isTopologyChanged = true;
+    }
+    pool.AttachToBus(h, unit.Index);
+    pool.SearchId(h) = unit.SearchCount;
+    t.Pin = unit.Pin;
+    t.Status = true;
+    t.IsParasitePowered = isParasitePowered;
+    if (isConnected && isThermometer)
+    {
+        updateDeviceConfig(h, data);
+    }
+    if (isNew)
+    {
+        t.Temperature = 0;
+        schedule(h, due);
+        armScheduler();
+    }
+    if (isRestored)
+    {
+        // the first temperature after restore is always posted, the device is read at once
+        pool.Posted(h).IsPosted = false;
+        pool.Schedule(h).Failures = 0;
+        schedule(h, due);
+        armScheduler();
+        pool.Stats(h).Restored++;
+        unit.Stats.Restored++;
+    }
+    pool.Publish(h);
+    strncpy(changes.Name, t.Name, sizeof(changes.Name));
+    xSemaphoreGiveRecursive(lock);
+
+    if (isRestored || isNew)
+    {
+        changes.Event = isNew ? UNIT_ADDED : UNIT_CONNECTION_RESTORED;
+        notifyThermometerChanges(&changes);
+    }
+}
+
+const char *Async1WireMgr::PrintAddress(Address1Wire addr)
+{
+    sprintf(addrPrinted, "%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X",
+            addr.addr[0], addr.addr[1], addr.addr[2], addr.addr[3],
+            addr.addr[4], addr.addr[5], addr.addr[6], addr.addr[7]);
+    return addrPrinted;
+}
+
+void Async1WireMgr::SetThermometerName(const char *newName, Address1Wire addr)
+{
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    ThermometerHandle h = pool.Find(addr);
+    ThermometerEvent changes;
+    strncpy(changes.Name, newName, sizeof(changes.Name));
+    changes.Name[LENGTH_OF_NAME - 1] = 0;
+    changes.Address = addr;
+    changes.ErrorCode = UNIT_OK;
+    if (h != NO_THERMOMETER)
+    {
+        Thermometer &thermometer = pool.Get(h);
+        thermometer.Status = false;
+        changes.Event = UNIT_RENAMED;
+        changes.Pin = thermometer.Pin;
+        strncpy(changes.OldName, thermometer.Name, sizeof(changes.OldName));
+
+        pool.Rename(h, newName);
+        isTopologyChanged = true;
+    }
+    else
+    {
+        h = pool.Add(addr, newName);
+        changes.Pin = 0;
+        changes.OldName[0] = 0;
+        if (h == NO_THERMOMETER)
+        {
+            changes.Event = UNIT_ERROR;
+            changes.ErrorCode = UNIT_NO_SPACE;
+            xSemaphoreGiveRecursive(lock);
+            notifyThermometerChanges(&changes);
+            return;
+        }
+        Thermometer &thermometer = pool.Get(h);
+        thermometer.Pin = 0;
+        thermometer.Status = false;
+        thermometer.IsParasitePowered = false;
+        thermometer.Resolution = 0;
+        thermometer.Temperature = 0;
+        pool.Publish(h);
+        isTopologyChanged = true;
+        // read as soon as it is found
+        schedule(h, millis());
+        armScheduler();
+
+        changes.Event = UNIT_ADDED;
+        xSemaphoreGiveRecursive(lock);
+        notifyThermometerChanges(&changes);
+
+        if (isDiscovery)
+        {
+            StartSearch();
+        }
+        return;
+    }
+    xSemaphoreGiveRecursive(lock);
+    // the events are posted without the lock: a full event loop doesn't stop the buses
+    notifyThermometerChanges(&changes);
+    postWork(nullptr, WORK_SAVE);
+}
+
+const Thermometer *Async1WireMgr::GetThermometer(ThermometerHandle h)
+{
+    if (h < 0 || h >= pool.Count())
+    {
+        return nullptr;
+    }
+    return &pool.Get(h);
+}
+
+int Async1WireMgr::GetSnapshots(ThermometerSnapshot *snapshots, int size)
+{
+    int n = 0;
+    for (ThermometerHandle h = 0; n < size && pool.ReadSnapshot(h, snapshots[n]); h++)
+    {
+        n++;
+    }
+    return n;
+}
+
+ThermometerHandle Async1WireMgr::FindThermometer(const char *name)
+{
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    ThermometerHandle h = pool.FindByName(name);
+    xSemaphoreGiveRecursive(lock);
+    return h;
+}
+
+const std::map<String, Thermometer *> Async1WireMgr::GetThermometers()
+{
+    std::map<String, Thermometer *> res;
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    for (ThermometerHandle h = 0; h < pool.Count(); h++)
+    {
+        res[String(pool.Get(h).Name)] = &pool.Get(h);
+    }
+    xSemaphoreGiveRecursive(lock);
+    return res;
+}
+
+void Async1WireMgr::SetTemperatureTimerInterval(ulong interval)
+{
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    temperatureTimerInterval = interval;
+    // the devices on the default interval are read now, then at the new rate
+    uint32_t now = millis();
+    for (ThermometerHandle h = 0; h < pool.Count(); h++)
+    {
+        if (pool.Schedule(h).Interval == 0)
+        {
+            schedule(h, now);
+        }
+    }
+    armScheduler();
+    xSemaphoreGiveRecursive(lock);
+}
+
+void Async1WireMgr::notifyThermometerChanges(ThermometerEvent *t)
+{
+    postEvent(ONEWIRE_EVENT_THERMOMETER, t, sizeof(ThermometerEvent));
+}
+void Async1WireMgr::notifyTemperatureChanges(ThermometerHandle h, TemperatureEvent *t)
+{
+    postEvent(ONEWIRE_EVENT_TEMPERATURE, t, sizeof(TemperatureEvent), h);
+}
+void Async1WireMgr::notifyBusChanges(BusEvent *event)
+{
+    postEvent(ONEWIRE_EVENT_BUS, event, sizeof(BusEvent));
+}
+void Async1WireMgr::notifyDeviceChanges(ThermometerHandle h, DeviceEvent *event)
+{
+    postEvent(ONEWIRE_EVENT_DEVICE, event, sizeof(DeviceEvent), h);
+}
+
+esp_err_t Async1WireMgr::postToLoop(int32_t eventId, const void *data, size_t size)
+{
+    if (eventLoop == nullptr)
+    {
+        return esp_event_post(ONEWIRE_EVENT, eventId, data, size, postPolicy.Timeout);
+    }
+    return esp_event_post_to(eventLoop, ONEWIRE_EVENT, eventId, data, size, postPolicy.Timeout);
+}
+
+void Async1WireMgr::postEvent(int32_t eventId, const void *data, size_t size, ThermometerHandle h)
+{
+    xSemaphoreTakeRecursive(outboxLock, portMAX_DELAY);
+    if (postPolicy.IsCoalesced && (eventId == ONEWIRE_EVENT_TEMPERATURE || eventId == ONEWIRE_EVENT_DEVICE))
+    {
+        for (uint16_t i = 0; i < outboxCount; i++)
+        {
+            PendingEvent &pending = outbox[(outboxHead + i) % POST_OUTBOX_LENGTH];
+            if (pending.EventId == eventId && pending.Handle == h)
+            {
+                memcpy(&pending.Data, data, size);
+                postStats.Coalesced++;
+                xSemaphoreGiveRecursive(outboxLock);
+                return;
+            }
+        }
+    }
+    if (outboxCount == POST_OUTBOX_LENGTH)
+    {
+        postStats.Dropped++;
+        if (postPolicy.Overflow == POST_DROP_NEWEST)
+        {
+            xSemaphoreGiveRecursive(outboxLock);
+            return;
+        }
+        outboxHead = (outboxHead + 1) % POST_OUTBOX_LENGTH;
+        outboxCount--;
+    }
+    // the event is queued even when the outbox is empty: the events are posted in their order
+    PendingEvent &pending = outbox[(outboxHead + outboxCount) % POST_OUTBOX_LENGTH];
+    pending.EventId = eventId;
+    pending.Handle = h;
+    pending.Size = (uint16_t)size;
+    memcpy(&pending.Data, data, size);
+    outboxCount++;
+    if (outboxCount > postStats.MaxPending)
+    {
+        postStats.MaxPending = outboxCount;
+    }
+    postOutbox();
+    xSemaphoreGiveRecursive(outboxLock);
+}
+
+void Async1WireMgr::postOutbox()
+{
+    xSemaphoreTakeRecursive(outboxLock, portMAX_DELAY);
+    // a handler of the host loop runs inside the post: its events are posted by this loop
+    if (isPosting)
+    {
+        xSemaphoreGiveRecursive(outboxLock);
+        return;
+    }
+    isPosting = true;
+    while (outboxCount > 0)
+    {
+        // taken out before the post: the handlers may add or coalesce events meanwhile
+        PendingEvent event = outbox[outboxHead];
+        outboxHead = (outboxHead + 1) % POST_OUTBOX_LENGTH;
+        outboxCount--;
+        if (postToLoop(event.EventId, &event.Data, event.Size) != ESP_OK)
+        {
+            // the loop is full: nothing was handled, the event is put back in front
+            outboxHead = (outboxHead + POST_OUTBOX_LENGTH - 1) % POST_OUTBOX_LENGTH;
+            outbox[outboxHead] = event;
+            outboxCount++;
+            postStats.Deferred++;
+            xTimerStart(postTimer, 0);
+            break;
+        }
+        postStats.Posted++;
+    }
+    isPosting = false;
+    xSemaphoreGiveRecursive(outboxLock);
+}
+
+void Async1WireMgr::countDropped()
+{
+    xSemaphoreTakeRecursive(outboxLock, portMAX_DELAY);
+    postStats.Dropped++;
+    xSemaphoreGiveRecursive(outboxLock);
+}
+
+void Async1WireMgr::SetPostPolicy(const PostPolicy &policy)
+{
+    xSemaphoreTakeRecursive(outboxLock, portMAX_DELAY);
+    postPolicy = policy;
+    xSemaphoreGiveRecursive(outboxLock);
+}
+
+void Async1WireMgr::GetPostStats(PostStats &stats)
+{
+    xSemaphoreTakeRecursive(outboxLock, portMAX_DELAY);
+    stats = postStats;
+    stats.Pending = outboxCount;
+    xSemaphoreGiveRecursive(outboxLock);
+}
+
+OneWireDevices Async1WireMgr::DetectFamily(Address1Wire deviceAddress)
+{
+    if (DS18x20::IsFamily(deviceAddress.addr[0]))
+    {
+        return ONEWIRE_DSTHERMO;
+    }
+    for (uint8_t i = 0; i < numbDrivers; i++)
+    {
+        if (driverFamilies[i] == deviceAddress.addr[0])
+        {
+            return ONEWIRE_FAMILY_DRIVER;
+        }
+    }
+    return ONEWIRE_GENERIC;
+}
+
+bool Async1WireMgr::RegisterDriver(uint8_t family, OneWireDriver *driver)
+{
+    if (driver == nullptr || DS18x20::IsFamily(family))
+    {
+        return false;
+    }
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    uint8_t i = 0;
+    while (i < numbDrivers && driverFamilies[i] != family)
+    {
+        i++;
+    }
+    bool isRegistered = i < MAX_FAMILY_DRIVERS;
+    if (isRegistered)
+    {
+        driverFamilies[i] = family;
+        drivers[i] = driver;
+        numbDrivers = i < numbDrivers ? numbDrivers : i + 1;
+    }
+    xSemaphoreGiveRecursive(lock);
+    return isRegistered;
+}
+
+OneWireDriver *Async1WireMgr::findDriver(uint8_t family)
+{
+    for (uint8_t i = 0; i < numbDrivers; i++)
+    {
+        if (driverFamilies[i] == family)
+        {
+            return drivers[i];
+        }
+    }
+    // a device of another family given by SetThermometerName() is read as a thermometer, as before the drivers
+    return &thermometerDriver;
+}
+
+OneWireDriver *Async1WireMgr::driverOf(ThermometerHandle h)
+{
+    return findDriver(pool.Get(h).Address.addr[0]);
+}
+
+bool Async1WireMgr::GetDeviceValues(ThermometerHandle h, DeviceValues &values)
+{
+    if (h < 0 || h >= pool.Count())
+    {
+        return false;
+    }
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    bool isRead = pool.Values(h).Count > 0;
+    if (isRead)
+    {
+        values = pool.Values(h);
+    }
+    xSemaphoreGiveRecursive(lock);
+    return isRead;
+}
+
+bool Async1WireMgr::GetBusStats(byte pin, BusStats &stats)
+{
+    OneWireBusUnit *unit = getBus(pin);
+    if (unit == nullptr)
+    {
+        return false;
+    }
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    stats = unit->Stats;
+    xSemaphoreGiveRecursive(lock);
+    return true;
+}
+
+bool Async1WireMgr::SetHistory(Address1Wire addr, TemperatureHistory *history)
+{
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    ThermometerHandle h = pool.Find(addr);
+    if (h != NO_THERMOMETER)
+    {
+        pool.History(h) = history;
+    }
+    xSemaphoreGiveRecursive(lock);
+    return h != NO_THERMOMETER;
+}
+
+bool Async1WireMgr::GetHistoryAggregate(ThermometerHandle h, uint8_t window, HistoryAggregate &aggregate)
+{
+    if (h < 0 || h >= pool.Count())
+    {
+        return false;
+    }
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    TemperatureHistory *history = pool.History(h);
+    bool isDone = history != nullptr && history->GetAggregate(window, aggregate);
+    xSemaphoreGiveRecursive(lock);
+    return isDone;
+}
+
+uint16_t Async1WireMgr::ReadHistory(ThermometerHandle h, uint32_t sequence, HistorySample *samples, uint16_t size)
+{
+    if (h < 0 || h >= pool.Count())
+    {
+        return 0;
+    }
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    TemperatureHistory *history = pool.History(h);
+    uint16_t count = history == nullptr ? 0 : history->ReadSince(sequence, samples, size);
+    xSemaphoreGiveRecursive(lock);
+    return count;
+}
+
+bool Async1WireMgr::GetThermometerStats(ThermometerHandle h, SensorStats &stats)
+{
+    if (h < 0 || h >= pool.Count())
+    {
+        return false;
+    }
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    stats = pool.Stats(h);
+    xSemaphoreGiveRecursive(lock);
+    return true;
+}
+
+void Async1WireMgr::ResetStats()
+{
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    for (int i = 0; i < numbBuses; i++)
+    {
+        memset(&oneWireCollection[i].Stats, 0, sizeof(BusStats));
+    }
+    for (ThermometerHandle h = 0; h < pool.Count(); h++)
+    {
+        memset(&pool.Stats(h), 0, sizeof(SensorStats));
+    }
+    xSemaphoreGiveRecursive(lock);
+    xSemaphoreTakeRecursive(outboxLock, portMAX_DELAY);
+    memset(&postStats, 0, sizeof(postStats));
+    xSemaphoreGiveRecursive(outboxLock);
+}
+
+void Async1WireMgr::SetStatsInterval(uint32_t interval)
+{
+    if (interval == 0)
+    {
+        xTimerStop(statsTimer, 0);
+    }
+    else
+    {
+        xTimerChangePeriod(statsTimer, pdMS_TO_TICKS(interval), 0);
+    }
+}
+
+void Async1WireMgr::notifyStats()
+{
+    for (int i = 0; i < MAX_ONEWIRE_BUSES; i++)
+    {
+        OneWireBusUnit *unit = getBusAt(i);
+        if (unit == nullptr)
+        {
+            continue;
+        }
+        BusStatsEvent event;
+        event.Pin = unit->Pin;
+        xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+        event.Stats = unit->Stats;
+        xSemaphoreGiveRecursive(lock);
+        if (postToLoop(ONEWIRE_EVENT_STATS, &event, sizeof(event)) != ESP_OK)
+        {
+            countDropped();
+        }
+    }
+}
+
+void Async1WireMgr::onTemperatureLoopTimer(TimerHandle_t xTimer)
+{
+    // the timer service task is shared by all timers of the firmware: the bus work is done by the worker
+    ((Async1WireMgr *)pvTimerGetTimerID(xTimer))->postWork(nullptr, WORK_START_CYCLE);
+}
+
+void Async1WireMgr::onStatsTimer(TimerHandle_t xTimer)
+{
+    ((Async1WireMgr *)pvTimerGetTimerID(xTimer))->postWork(nullptr, WORK_STATS);
+}
+
+void Async1WireMgr::onSearchTimer(TimerHandle_t xTimer)
+{
+    ((Async1WireMgr *)pvTimerGetTimerID(xTimer))->postWork(nullptr, WORK_SEARCH_ALL);
+}
+
+void Async1WireMgr::onPostTimer(TimerHandle_t xTimer)
+{
+    ((Async1WireMgr *)pvTimerGetTimerID(xTimer))->postWork(nullptr, WORK_POST);
+}
+
+void Async1WireMgr::onCollectTimer(TimerHandle_t xTimer)
+{
+    OneWireBusUnit *unit = (OneWireBusUnit *)pvTimerGetTimerID(xTimer);
+    unit->Worker.Manager->postWork(unit, WORK_COLLECT);
+}
+
+#ifdef ARDUINO
+void Async1WireMgr::workerLoop(void *arg)
+{
+    WorkerTask *w = (WorkerTask *)arg;
+    WorkItem item;
+    for (;;)
+    {
+        if (xQueueReceive(w->Queue, &item, portMAX_DELAY) == pdTRUE)
+        {
+            if (item.Type == WORK_EXIT)
+            {
+                QueueHandle_t queue = w->Queue;
+                w->Queue = NULL;
+                w->Task = NULL;
+                vQueueDelete(queue);
+                vTaskDelete(NULL);
+            }
+            w->Manager->processWork(item);
+        }
+    }
+}
+#endif
+
+void Async1WireMgr::startBusTask(OneWireBusUnit &unit)
+{
+#ifdef ARDUINO
+    if (!unit.HasOwnTask || unit.Worker.Queue != NULL)
+    {
+        return;
+    }
+    char name[16];
+    snprintf(name, sizeof(name), "Async1Wire%u", unit.Pin);
+    unit.Worker.Queue = xQueueCreate(WORK_QUEUE_LENGTH, sizeof(WorkItem));
+    xTaskCreatePinnedToCore(workerLoop, name, WORKER_TASK_STACK_SIZE, &unit.Worker, unit.Priority, &unit.Worker.Task,
+                            unit.Core);
+#endif
+}
+
+void Async1WireMgr::postWork(OneWireBusUnit *unit, WorkType type, TaskHandle_t notify)
+{
+    WorkItem item;
+    item.Type = type;
+    item.Pin = (unit == nullptr) ? 0 : unit->Pin;
+    item.Notify = notify;
+#ifdef ARDUINO
+    QueueHandle_t queue = (unit != nullptr && unit->Worker.Queue != NULL) ? unit->Worker.Queue : worker.Queue;
+    if (xQueueSend(queue, &item, 0) != pdTRUE)
+    {
+        Serial.printf("Async1Wire: work queue is full\n");
+    }
+#else
+    // no tasks on the host build: the work is done by the caller
+    processWork(item);
+#endif
+}
+
+void Async1WireMgr::processWork(WorkItem &item)
+{
+    if (item.Type == WORK_START_CYCLE)
+    {
+        dispatchDue();
+    }
+    else if (item.Type == WORK_STATS)
+    {
+        notifyStats();
+    }
+    else if (item.Type == WORK_SAVE)
+    {
+        saveTopology();
+    }
+    else if (item.Type == WORK_SEARCH_ALL)
+    {
+        searchIdleBuses();
+    }
+    else if (item.Type == WORK_POST)
+    {
+        postOutbox();
+    }
+    else
+    {
+        OneWireBusUnit *unit = getBus(item.Pin);
+        if (unit != nullptr)
+        {
+            runBusWork(*unit, item.Type);
+        }
+    }
+#ifdef ARDUINO
+    if (item.Notify != NULL)
+    {
+        xTaskNotifyGive(item.Notify);
+    }
+#endif
+}
+
+void Async1WireMgr::runBusWork(OneWireBusUnit &unit, WorkType type)
+{
+    xSemaphoreTakeRecursive(unit.Lock, portMAX_DELAY);
+    if (unit.Wire != nullptr)
+    {
+        switch (type)
+        {
+        case WORK_START_BUS:
+            startConversion(unit);
+            break;
+        case WORK_COLLECT:
+        {
+            bool isBusy = unit.Phase != BUS_IDLE;
+            collect(unit);
+            if (isBusy && unit.Phase == BUS_IDLE)
+            {
+                xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+                unit.Stats.Cycles++;
+                AddLatency(unit.Stats.Cycle, micros() - unit.CycleStart);
+                xSemaphoreGiveRecursive(lock);
+                completeReads(unit);
+            }
+            if (unit.Phase == BUS_IDLE && unit.DueCount > 0)
+            {
+                // devices got due while the bus was busy
+                startConversion(unit);
+            }
+        }
+        break;
+        case WORK_SEARCH:
+            searchBus(unit);
+            break;
+        case WORK_SEARCH_STEP:
+            if (unit.Phase == BUS_IDLE)
+            {
+                // only between the conversion cycles
+                xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+                bool isToStart = unit.IsSearchRequested && !unit.IsSearching;
+                bool isSearching = unit.IsSearching || isToStart;
+                xSemaphoreGiveRecursive(lock);
+                if (isToStart)
+                {
+                    startSearch(unit);
+                }
+                if (isSearching)
+                {
+                    searchStep(unit, SEARCH_STEP_DEVICES);
+                }
+            }
+            break;
+        case WORK_VERIFY:
+            verifyBus(unit);
+            break;
+        default:
+            break;
+        }
+        if (unit.Phase == BUS_IDLE)
+        {
+            // the cycle of the bus is over
+            flushBatch(unit);
+            completeReads(unit);
+        }
+    }
+    xSemaphoreGiveRecursive(unit.Lock);
+}
 
-        for (auto &oneWire : oneWireCollection)
+OneWireBusUnit *Async1WireMgr::getBus(byte pin)
+{
+    OneWireBusUnit *res = nullptr;
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    for (int i = 0; i < numbBuses; i++)
+    {
+        if (oneWireCollection[i].Pin == pin && oneWireCollection[i].Wire != nullptr)
         {
-            oneWire.second->begin(oneWire.first);
+            res = &oneWireCollection[i];
         }
-        isInitialized = true;
     }
-    SearchDevices();
-    requestTemperature();
-    xTimerStart(temperatureLoopTimer, 0);
+    xSemaphoreGiveRecursive(lock);
+    return res;
 }
 
-bool Async1WireMgr::Add1Wire(byte pin)
+OneWireBusUnit *Async1WireMgr::getBusAt(int index)
 {
-    if (oneWireCollection.find(pin) != oneWireCollection.end())
+    OneWireBusUnit *res = nullptr;
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    if (index < numbBuses && oneWireCollection[index].Wire != nullptr)
     {
-        return false;
+        res = &oneWireCollection[index];
     }
-    oneWireCollection[pin] = new OneWire();
-    if (isInitialized)
+    xSemaphoreGiveRecursive(lock);
+    return res;
+}
+
+ThermometerHandle Async1WireMgr::nextOnBus(OneWireBusUnit &unit, ThermometerHandle h)
+{
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    if (h == NO_THERMOMETER)
     {
-        oneWireCollection[pin]->begin(pin);
+        h = pool.FirstOnBus(unit.Index);
     }
-    return true;
+    else if (pool.GetBus(h) == unit.Index)
+    {
+        h = pool.NextOnBus(h);
+    }
+    else
+    {
+        // the device was moved to another bus by its search: the rest of the list is not ours
+        h = NO_THERMOMETER;
+    }
+    xSemaphoreGiveRecursive(lock);
+    return h;
 }
 
-bool Async1WireMgr::Remove1Wire(byte pin)
+void Async1WireMgr::startConversion(OneWireBusUnit &unit)
 {
-    if (oneWireCollection.find(pin) != oneWireCollection.end())
+    if (unit.Phase != BUS_IDLE)
     {
-        oneWireCollection.erase(pin);
-        return true;
+        // previous cycle is not over yet
+        return;
+    }
+    writeConfig(unit);
+    if (!claimDue(unit))
+    {
+        return;
+    }
+    unit.CycleStart = micros();
+    if (isBroadcast(unit))
+    {
+        if (!startBroadcast(unit))
+        {
+            // nobody on the bus: the devices are not read one by one
+            abortCycle(unit);
+            return;
+        }
+        setBusSuspended(unit, false);
+        addStartLatency(unit, unit.CycleStart);
+        unit.Phase = BUS_CONVERTING_ALL;
+        armCollectTimer(unit, getConversionTime(unit));
+    }
+    else
+    {
+        unit.CycleDevice = nextByPriority(unit, NO_THERMOMETER);
+        convertNextDevice(unit);
     }
-    return false;
 }
 
-void Async1WireMgr::SearchDevices()
+bool Async1WireMgr::startBroadcast(OneWireBusUnit &unit)
 {
-    if (isInitialized)
+    // each convert command of the families due is sent once: the families sharing it convert together
+    uint8_t commands[MAX_FAMILY_DRIVERS + 1];
+    OneWireDriver *converters[MAX_FAMILY_DRIVERS + 1];
+    uint8_t count = 0;
+    for (ThermometerHandle h = nextInCycle(unit, NO_THERMOMETER); h != NO_THERMOMETER; h = nextInCycle(unit, h))
+    {
+        OneWireDriver *driver = driverOf(h);
+        uint8_t command = driver->ConvertCommand();
+        uint8_t i = 0;
+        while (i < count && commands[i] != command)
+        {
+            i++;
+        }
+        if (command != 0 && i == count && count < MAX_FAMILY_DRIVERS + 1)
+        {
+            commands[count] = command;
+            converters[count++] = driver;
+        }
+    }
+    if (count == 0)
     {
-        std::map<String, Thermometer *> inActiveThermometers;
+        // nothing to convert: the presence is checked, the devices are read at once
+        return unit.Wire->reset() == 1;
+    }
+    for (uint8_t i = 0; i < count; i++)
+    {
+        if (!converters[i]->StartConversion(unit.Wire, nullptr, false))
+        {
+            return false;
+        }
+    }
+    return true;
+}
 
-        for (auto &thermometer : thermometers)
+bool Async1WireMgr::claimDue(OneWireBusUnit &unit)
+{
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    bool isClaimed = unit.DueCount > 0;
+    if (isClaimed)
+    {
+        for (ThermometerHandle h = pool.FirstOnBus(unit.Index); h != NO_THERMOMETER; h = pool.NextOnBus(h))
         {
-            if (!thermometer.second->Status)
+            ThermometerSchedule &s = pool.Schedule(h);
+            if (s.IsDue)
             {
-                inActiveThermometers[thermometer.first] = thermometer.second;
+                s.IsDue = false;
+                s.IsInCycle = true;
             }
-            else
+        }
+        unit.DueCount = 0;
+        for (int i = 0; i < READ_REQUEST_SLOTS && numbReadRequests > 0; i++)
+        {
+            PendingRead &pending = readRequests[i];
+            if (pending.IsUsed && pending.Handle == NO_THERMOMETER && pending.Bus == unit.Index)
             {
-                thermometer.second->Status = false;
+                pending.IsClaimed = true;
             }
         }
+    }
+    xSemaphoreGiveRecursive(lock);
+    return isClaimed;
+}
 
-        for (auto &oneWireUnit : oneWireCollection)
-        {
-            oneWireUnit.second->reset_search();
-            Address1Wire deviceAddress;
-            // Step1: find all devices
-            std::vector<Address1Wire> foundDevices;
-            while (oneWireUnit.second->search(deviceAddress.addr))
-            {
-                if (oneWireUnit.second->crc8(deviceAddress.addr, 7) != deviceAddress.addr[7])
-                {
-                    Thermometer *t = getThermometer(deviceAddress);
-                    ThermometerEvent tc;
-                    tc.Address = deviceAddress;
-                    tc.Event = UNIT_ERROR;
-                    strncpy(tc.Name, t->Name.c_str(), sizeof(tc.Name));
-                    tc.OldName[0] = 0;
-                    tc.Pin = t->Pin;
-                    tc.ErrorCode = UNIT_CRC_ERROR;
-                    notifyThermometerChanges(&tc);
-                    continue;
-                }
+ThermometerHandle Async1WireMgr::nextInCycle(OneWireBusUnit &unit, ThermometerHandle h)
+{
+    // IsInCycle is changed by the worker of the bus only
+    do
+    {
+        h = nextOnBus(unit, h);
+    } while (h != NO_THERMOMETER && !pool.Schedule(h).IsInCycle);
+    return h;
+}
 
-                foundDevices.push_back(deviceAddress);
-            }
-            // Step2: detect device found
-            DallasTemperature dt = DallasTemperature(oneWireUnit.second);
-            for (auto &addr : foundDevices)
+ThermometerHandle Async1WireMgr::nextByPriority(OneWireBusUnit &unit, ThermometerHandle h)
+{
+    // the devices of the cycle by descending priority, by the bus list within one priority.
+    // h has left the cycle: the devices of its priority before it are read already.
+    if (h != NO_THERMOMETER)
+    {
+        uint8_t priority = pool.Schedule(h).Priority;
+        for (h = nextInCycle(unit, h); h != NO_THERMOMETER; h = nextInCycle(unit, h))
+        {
+            if (pool.Schedule(h).Priority == priority)
             {
-                switch (DetectFamily(addr))
-                {
-                case ONEWIRE_DSTHERMO:
-                {
-                    Thermometer *t = getThermometer(addr);
-                    bool isNew = (t == nullptr);
-                    if (isNew)
-                    {
-                        t = new Thermometer();
-                        t->Name = "T" + String(addr.packedAddress, HEX);
-                        t->Address = addr;
-                        thermometers[t->Name] = t;
-                    }
-                    t->Pin = oneWireUnit.first;
-                    t->Status = true;
-                    t->IsParasitePowered = dt.isParasitePowerMode();
-                    t->Resolution = dt.getResolution(addr.addr);
-                    t->Temperature = 0;
-                    dt.setResolution(addr.addr, DEFAULT_RESOLUTION);
-
-                    if (inActiveThermometers.count(t->Name) > 0 || isNew)
-                    {
-                        ThermometerEvent changes;
-                        strncpy(changes.Name, t->Name.c_str(), sizeof(changes.Name));
-                        changes.Address = t->Address;
-                        changes.Pin = t->Pin;
-                        changes.OldName[0] = 0;
-
-                        if (isNew)
-                        {
-                            changes.Event = UNIT_ADDED;
-                        }
-                        else
-                        {
-                            changes.Event = UNIT_CONNECTION_RESTORED;
-                        }
-                        notifyThermometerChanges(&changes);
-                    }
-                }
-                break;
-                }
+                return h;
             }
         }
-        for (auto &thermometer : thermometers)
+    }
+    ThermometerHandle first = NO_THERMOMETER;
+    for (h = nextInCycle(unit, NO_THERMOMETER); h != NO_THERMOMETER; h = nextInCycle(unit, h))
+    {
+        if (first == NO_THERMOMETER || pool.Schedule(h).Priority > pool.Schedule(first).Priority)
         {
-            if (!thermometer.second->Status)
-            {
-                if (inActiveThermometers.count(thermometer.first) == 0)
-                {
-                    ThermometerEvent changes;
-                    changes.Event = UNIT_CONNECTION_LOST;
-                    strncpy(changes.Name, thermometer.second->Name.c_str(), sizeof(changes.Name));
-                    changes.Address = thermometer.second->Address;
-                    changes.Pin = thermometer.second->Pin;
-                    changes.OldName[0] = 0;
-                    notifyThermometerChanges(&changes);
-                }
-            }
+            first = h;
         }
     }
+    return first;
 }
 
-const char *Async1WireMgr::PrintAddress(Address1Wire addr)
+void Async1WireMgr::endCycle(OneWireBusUnit &unit)
 {
-    sprintf(addrPrinted, "%02X:%02X:%02X:%02X:%02X:%02X:%02X:%02X",
-            addr.addr[0], addr.addr[1], addr.addr[2], addr.addr[3],
-            addr.addr[4], addr.addr[5], addr.addr[6], addr.addr[7]);
-    return addrPrinted;
+    for (ThermometerHandle h = nextOnBus(unit, NO_THERMOMETER); h != NO_THERMOMETER; h = nextOnBus(unit, h))
+    {
+        pool.Schedule(h).IsInCycle = false;
+    }
 }
 
-void Async1WireMgr::SetThermometerName(String newName, Address1Wire addr)
+void Async1WireMgr::schedule(ThermometerHandle h, uint32_t due)
 {
-    Thermometer *thermometer = getThermometer(addr);
-    ThermometerEvent changes;
-    strncpy(changes.Name, newName.c_str(), sizeof(changes.Name));
-    changes.Address = addr;
-    if (thermometer != nullptr)
+    ThermometerSchedule &s = pool.Schedule(h);
+    s.Due = due;
+    if (!deadlines.Push(due, s.Priority, h))
     {
-        thermometer->Status = false;
-        changes.Event = UNIT_RENAMED;
-        changes.Pin = thermometer->Pin;
-        strncpy(changes.OldName, thermometer->Name.c_str(), sizeof(changes.OldName));
-        notifyThermometerChanges(&changes);
+        // full of stale entries: each thermometer has one live deadline, rebuild from the pool
+        deadlines.Clear();
+        for (ThermometerHandle i = 0; i < pool.Count(); i++)
+        {
+            deadlines.Push(pool.Schedule(i).Due, pool.Schedule(i).Priority, i);
+        }
+    }
+}
 
-        thermometers.erase(thermometer->Name);
-        thermometer->Name = newName;
-        thermometers[newName] = thermometer;
+void Async1WireMgr::armScheduler()
+{
+    if (deadlines.Size() == 0)
+    {
+        return;
     }
-    else
+    int32_t delay = (int32_t)(deadlines.Top().Due - millis());
+    TickType_t ticks = delay > 0 ? pdMS_TO_TICKS(delay) : 0;
+    xTimerChangePeriod(temperatureLoopTimer, ticks > 0 ? ticks : 1, 0);
+}
+
+uint32_t Async1WireMgr::intervalOf(ThermometerHandle h)
+{
+    uint32_t interval = pool.Schedule(h).Interval;
+    if (interval == 0)
     {
-        thermometer = new Thermometer();
-        thermometer->Name = newName;
-        thermometer->Pin = 0;
-        thermometer->Address = addr;
-        thermometer->Status = false;
-        thermometer->IsParasitePowered = false;
-        thermometer->Resolution = DEFAULT_RESOLUTION;
-        thermometer->Temperature = 0;
-        thermometers[newName] = thermometer;
+        interval = temperatureTimerInterval;
+    }
+    // the next deadline must be out of the window of this dispatch
+    return interval > SCHEDULE_BATCH_WINDOW ? interval : SCHEDULE_BATCH_WINDOW + 1;
+}
 
-        changes.Event = UNIT_ADDED;
-        changes.Pin = 0;
-        changes.OldName[0] = 0;
-        notifyThermometerChanges(&changes);
+void Async1WireMgr::dispatchDue()
+{
+    uint32_t busMask = 0;
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    uint32_t now = millis();
+    uint32_t windowEnd = now + SCHEDULE_BATCH_WINDOW;
+    while (deadlines.Size() > 0 && !DeadlineQueue::IsBefore(windowEnd, deadlines.Top().Due))
+    {
+        DeadlineQueue::Entry e = deadlines.Top();
+        deadlines.Pop();
+        ThermometerSchedule &s = pool.Schedule(e.Handle);
+        if (e.Due != s.Due || e.Priority != s.Priority)
+        {
+            // the schedule was changed after the push
+            continue;
+        }
+        uint32_t interval = intervalOf(e.Handle);
+        uint32_t next = s.Due + interval;
+        if (!DeadlineQueue::IsBefore(windowEnd, next))
+        {
+            // late: the missed reads are not caught up
+            next = now + interval;
+        }
+        schedule(e.Handle, next);
+        int8_t bus = pool.GetBus(e.Handle);
+        if (bus == NO_BUS)
+        {
+            continue;
+        }
+        s.IsDue = true;
+        oneWireCollection[bus].DueCount++;
+        busMask |= 1u << bus;
+    }
+    armScheduler();
+    xSemaphoreGiveRecursive(lock);
 
-        SearchDevices();
+    for (int i = 0; i < MAX_ONEWIRE_BUSES; i++)
+    {
+        OneWireBusUnit *unit = getBusAt(i);
+        if (unit == nullptr || (busMask & (1u << i)) == 0)
+        {
+            continue;
+        }
+        if (unit->Worker.Queue != NULL)
+        {
+            postWork(unit, WORK_START_BUS);
+        }
+        else
+        {
+            runBusWork(*unit, WORK_START_BUS);
+        }
     }
 }
 
-void Async1WireMgr::SetTemperatureTimerInterval(ulong interval)
+void Async1WireMgr::collect(OneWireBusUnit &unit)
 {
-    temperatureTimerInterval = interval;
-    xTimerChangePeriod(temperatureLoopTimer, pdMS_TO_TICKS(temperatureTimerInterval), 0);
+    if (unit.Phase != BUS_IDLE)
+    {
+        xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+        AddLatency(unit.Stats.Conversion, micros() - unit.ConversionStart);
+        xSemaphoreGiveRecursive(lock);
+    }
+    switch (unit.Phase)
+    {
+    case BUS_CONVERTING_ALL:
+        unit.Phase = BUS_IDLE;
+        if (unit.Read == READ_ALARMED && unit.CyclesToFullRead > 0)
+        {
+            unit.CyclesToFullRead--;
+            readAlarmed(unit);
+            // the requested devices and the families without alarms are read even without the alarm
+            for (ThermometerHandle h = nextInCycle(unit, NO_THERMOMETER); h != NO_THERMOMETER && !unit.IsSuspended;
+                 h = nextInCycle(unit, h))
+            {
+                if (pool.Schedule(h).HasRequest || !DS18x20::IsFamily(pool.Get(h).Address.addr[0]))
+                {
+                    readThermometer(unit, h);
+                }
+            }
+            endCycle(unit);
+            break;
+        }
+        unit.CyclesToFullRead = unit.FullReadCycles;
+        for (ThermometerHandle h = nextByPriority(unit, NO_THERMOMETER); h != NO_THERMOMETER && !unit.IsSuspended;
+             h = nextByPriority(unit, h))
+        {
+            readThermometer(unit, h);
+        }
+        if (unit.IsSuspended)
+        {
+            // the bus failed during the reads: the rest of the cycle is dropped
+            endCycle(unit);
+        }
+        break;
+    case BUS_CONVERTING_DEVICE:
+        // release the strong pullup of parasite powered device
+        unit.Wire->depower();
+        readThermometer(unit, unit.CycleDevice);
+        if (unit.IsSuspended)
+        {
+            abortCycle(unit);
+            break;
+        }
+        unit.CycleDevice = nextByPriority(unit, unit.CycleDevice);
+        convertNextDevice(unit);
+        break;
+    default:
+        break;
+    }
 }
 
-Thermometer *Async1WireMgr::getThermometer(Address1Wire addr)
+void Async1WireMgr::readAlarmed(OneWireBusUnit &unit)
 {
-    for (auto &thermometer : thermometers)
+    // each device is read as soon as it answers: the search state is kept by the bus between the calls
+    Address1Wire addr;
+    unit.Wire->reset_search();
+    while (unit.Wire->search(addr.addr, false))
     {
-        if (thermometer.second->Address.packedAddress == addr.packedAddress)
+        if (OneWireBus::crc8(addr.addr, 7) != addr.addr[7])
+        {
+            continue;
+        }
+        xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+        ThermometerHandle h = pool.Find(addr);
+        bool isOnBus = (h != NO_THERMOMETER && pool.GetBus(h) == unit.Index);
+        xSemaphoreGiveRecursive(lock);
+        // the devices not known yet are added by the next SearchDevices(), the devices not due are read later
+        if (isOnBus && pool.Schedule(h).IsInCycle)
         {
-            return thermometer.second;
+            readThermometer(unit, h);
         }
     }
-    return nullptr;
 }
 
-void Async1WireMgr::notifyThermometerChanges(ThermometerEvent *t)
+void Async1WireMgr::writeConfig(OneWireBusUnit &unit)
 {
-    esp_err_t res;
-
-    if (eventLoop == nullptr)
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    bool isPending = unit.ConfigPending;
+    unit.ConfigPending = false;
+    xSemaphoreGiveRecursive(lock);
+    if (!isPending)
     {
-        res = esp_event_post(ONEWIRE_EVENT, ONEWIRE_EVENT_THERMOMETER, t, sizeof(ThermometerEvent), portMAX_DELAY);
+        return;
     }
-    else
+    for (ThermometerHandle h = nextOnBus(unit, NO_THERMOMETER); h != NO_THERMOMETER; h = nextOnBus(unit, h))
     {
-        res = esp_event_post_to(eventLoop, ONEWIRE_EVENT, ONEWIRE_EVENT_THERMOMETER, t, sizeof(ThermometerEvent), portMAX_DELAY);
+        xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+        Thermometer t = pool.Get(h);
+        ThermometerConfig config = pool.Config(h);
+        isPending = config.IsPending && t.Status && isConfigDifferent(h);
+        pool.Config(h).IsPending = isPending;
+        xSemaphoreGiveRecursive(lock);
+        if (!isPending)
+        {
+            continue;
+        }
+        // one write of the scratchpad and one copy to EEPROM for everything that differs:
+        // the device state is known from the last read, it is not read again
+        uint8_t scratchPad[DS18X20_SCRATCHPAD_SIZE];
+        scratchPad[DS18X20_LOW_ALARM_TEMP] = (uint8_t)(config.HasAlarms ? config.AlarmLow : t.AlarmLow);
+        scratchPad[DS18X20_HIGH_ALARM_TEMP] = (uint8_t)(config.HasAlarms ? config.AlarmHigh : t.AlarmHigh);
+        scratchPad[DS18X20_CONFIGURATION] =
+            DS18x20::ResolutionToConfig(config.Resolution != 0 ? config.Resolution : DEFAULT_RESOLUTION);
+        DS18x20::WriteScratchPad(unit.Wire, t.Address.addr, scratchPad, true, t.IsParasitePowered);
+
+        xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+        // the cache is what was written, the next read of the device confirms it
+        updateDeviceConfig(h, scratchPad);
+        xSemaphoreGiveRecursive(lock);
     }
-    if (res != ESP_OK)
+}
+
+bool Async1WireMgr::convertNextDevice(OneWireBusUnit &unit)
+{
+    while (unit.CycleDevice != NO_THERMOMETER)
     {
-        Serial.printf("esp_event_post failed: %d\n", res);
+        Thermometer &t = pool.Get(unit.CycleDevice);
+        OneWireDriver *driver = driverOf(unit.CycleDevice);
+        bool isConverted = driver->ConvertCommand() != 0;
+        if (!t.Status || !isConverted)
+        {
+            // lost device is not converted, just checked; a device without conversion is just read
+            readThermometer(unit, unit.CycleDevice);
+            if (unit.IsSuspended)
+            {
+                abortCycle(unit);
+                return false;
+            }
+        }
+        if (t.Status && isConverted)
+        {
+            uint32_t start = micros();
+            if (!driver->StartConversion(unit.Wire, t.Address.addr, t.IsParasitePowered))
+            {
+                abortCycle(unit);
+                return false;
+            }
+            setBusSuspended(unit, false);
+            addStartLatency(unit, start);
+            unit.Phase = BUS_CONVERTING_DEVICE;
+            armCollectTimer(unit, driver->ConversionTimeMicros(t.Resolution));
+            return true;
+        }
+        pool.Schedule(unit.CycleDevice).IsInCycle = false;
+        unit.CycleDevice = nextByPriority(unit, unit.CycleDevice);
     }
+    unit.Phase = BUS_IDLE;
+    return false;
 }
 
-void Async1WireMgr::notifyTemperatureChanges(TemperatureEvent *t)
+void Async1WireMgr::abortCycle(OneWireBusUnit &unit)
 {
-    esp_err_t res;
+    setBusSuspended(unit, true);
+    endCycle(unit);
+    unit.CycleDevice = NO_THERMOMETER;
+    unit.Phase = BUS_IDLE;
+}
 
-    if (eventLoop == nullptr)
+void Async1WireMgr::setBusSuspended(OneWireBusUnit &unit, bool isSuspended)
+{
+    if (unit.IsSuspended == isSuspended)
     {
-        res = esp_event_post(ONEWIRE_EVENT, ONEWIRE_EVENT_TEMPERATURE, t, sizeof(ThermometerEvent), portMAX_DELAY);
+        return;
     }
-    else
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    unit.IsSuspended = isSuspended;
+    if (isSuspended)
+    {
+        unit.Stats.Suspends++;
+    }
+    xSemaphoreGiveRecursive(lock);
+    BusEvent event;
+    event.Pin = unit.Pin;
+    event.Event = isSuspended ? BUS_SUSPENDED : BUS_RESUMED;
+    notifyBusChanges(&event);
+}
+
+void Async1WireMgr::quarantine(ThermometerHandle h)
+{
+    ThermometerSchedule &s = pool.Schedule(h);
+    if (s.Failures < 16)
     {
-        res = esp_event_post_to(eventLoop, ONEWIRE_EVENT, ONEWIRE_EVENT_TEMPERATURE, t, sizeof(ThermometerEvent), portMAX_DELAY);
+        s.Failures++;
     }
-    if (res != ESP_OK)
+    // 2, 4, 8... read intervals
+    uint32_t interval = intervalOf(h);
+    for (uint8_t i = 0; i < s.Failures && interval < LOST_PROBE_MAX_INTERVAL; i++)
     {
-        Serial.printf("esp_event_post failed: %d\n", res);
+        interval = interval * 2 < LOST_PROBE_MAX_INTERVAL ? interval * 2 : LOST_PROBE_MAX_INTERVAL;
     }
+    schedule(h, millis() + interval);
 }
 
-OneWireDevices Async1WireMgr::DetectFamily(Address1Wire deviceAddress)
+void Async1WireMgr::addStartLatency(OneWireBusUnit &unit, uint32_t start)
+{
+    unit.ConversionStart = micros();
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    AddLatency(unit.Stats.Start, unit.ConversionStart - start);
+    xSemaphoreGiveRecursive(lock);
+}
+
+void Async1WireMgr::armCollectTimer(OneWireBusUnit &unit, uint32_t conversionTime)
+{
+    TickType_t ticks = pdMS_TO_TICKS((conversionTime + 999) / 1000);
+    xTimerChangePeriod(unit.CollectTimer, ticks > 0 ? ticks : 1, 0);
+}
+
+uint32_t Async1WireMgr::getConversionTime(OneWireBusUnit &unit)
 {
-    switch (deviceAddress.addr[0])
+    // the longest conversion of all devices converted. A device lost, reprobed or renamed may have been
+    // powered up again with its default resolution: the longest possible one until it is read.
+    uint32_t conversionTime = 0;
+    for (ThermometerHandle h = nextInCycle(unit, NO_THERMOMETER); h != NO_THERMOMETER; h = nextInCycle(unit, h))
     {
-    case DS18S20MODEL:
-    case DS18B20MODEL:
-    case DS1822MODEL:
-    case DS1825MODEL:
-    case DS28EA00MODEL:
-        return ONEWIRE_DSTHERMO;
-    default:
-        return ONEWIRE_GENERIC;
+        Thermometer &t = pool.Get(h);
+        OneWireDriver *driver = driverOf(h);
+        if (driver->ConvertCommand() == 0)
+        {
+            continue;
+        }
+        // not read yet (resolution 0): the longest
+        uint32_t deviceTime = driver->ConversionTimeMicros(t.Status ? t.Resolution : 0);
+        conversionTime = deviceTime > conversionTime ? deviceTime : conversionTime;
     }
+    return conversionTime;
 }
 
-void Async1WireMgr::onTemperatureLoopTimer(TimerHandle_t xTimer)
+void Async1WireMgr::readThermometer(OneWireBusUnit &unit, ThermometerHandle h)
 {
-    for (auto &ow : OneWireMgr.oneWireCollection)
+    // bus I/O is done without the collections lock, so the other buses are not stopped.
+    // The record is never moved or freed, the address is never changed.
+    Thermometer *t = &pool.Get(h);
+    OneWireDriver *driver = driverOf(h);
+    uint8_t data[DRIVER_DATA_SIZE];
+    uint32_t start = micros();
+    ScratchPadStatus status = driver->Read(unit.Wire, t->Address.addr, data);
+    uint8_t retry = 0;
+    for (; status == SCRATCHPAD_CRC_ERROR && retry < readRetries; retry++)
+    {
+        status = driver->Read(unit.Wire, t->Address.addr, data);
+    }
+    uint32_t duration = micros() - start;
+    if (status == SCRATCHPAD_NO_PRESENCE)
+    {
+        // the bus failed, not the device: one BusEvent instead of the loss of each device
+        xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+        pool.Schedule(h).IsInCycle = false;
+        xSemaphoreGiveRecursive(lock);
+        setBusSuspended(unit, true);
+        return;
+    }
+    setBusSuspended(unit, false);
+    bool isThermometer = driver->IsThermometer();
+    DeviceValues values;
+    memset(&values, 0, sizeof(values));
+    double temp = DEVICE_DISCONNECTED_C;
+    if (status == SCRATCHPAD_OK)
+    {
+        driver->Decode(t->Address.addr, data, values);
+        temp = isThermometer ? values.Values[0] : temp;
+    }
+    // 1/16 degree of the history, as the DS18B20 register
+    int16_t raw = status == SCRATCHPAD_OK ? (int16_t)floorf(values.Values[0] * 16) : 0;
+    temp = round(temp * 10) / 10;
+
+    ThermometerEvent changes;
+    changes.ErrorCode = UNIT_OK;
+    bool isChanged = false;
+    TemperatureEvent temperature;
+    bool isTemperatureChanged = false;
+    DeviceEvent device;
+    // DS18x20 has the temperature only: its events are enough
+    bool isDeviceChanged = false;
+
+    xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+    ThermometerSchedule &s = pool.Schedule(h);
+    s.IsInCycle = false;
+    if (!t->Status)
+    {
+        unit.Stats.Probes++;
+    }
+    SensorStats &stats = pool.Stats(h);
+    stats.Reads++;
+    stats.Retries += retry;
+    AddLatency(stats.Read, duration);
+    unit.Stats.Reads++;
+    unit.Stats.Retries += retry;
+    AddLatency(unit.Stats.Read, duration);
+    TemperatureHistory *history = pool.History(h);
+    if (history != nullptr && isThermometer)
+    {
+        history->Add(millis() - (micros() - unit.ConversionStart) / 1000, raw,
+                     status == SCRATCHPAD_OK          ? SAMPLE_OK
+                     : status == SCRATCHPAD_CRC_ERROR ? SAMPLE_CRC_ERROR
+                                                      : SAMPLE_LOST);
+    }
+    if (status == SCRATCHPAD_CRC_ERROR)
+    {
+        stats.CrcErrors++;
+        unit.Stats.CrcErrors++;
+        // the device is there, but the data can't be trusted: keep the last temperature
+        isChanged = true;
+        changes.Event = UNIT_ERROR;
+        changes.ErrorCode = UNIT_CRC_ERROR;
+    }
+    else if (status == SCRATCHPAD_OK)
     {
-        OneWire *oneWire = ow.second;
-        DallasTemperature dt = DallasTemperature(oneWire);
-        for (auto &th : OneWireMgr.thermometers)
+        s.Failures = 0;
+        t->LastRead = millis();
+        if (!t->Status)
+        {
+            t->Status = true;
+            isChanged = true;
+            changes.Event = UNIT_CONNECTION_RESTORED;
+            pool.Posted(h).IsPosted = false;
+            stats.Restored++;
+            unit.Stats.Restored++;
+        }
+        if (DS18x20::IsFamily(t->Address.addr[0]))
+        {
+            updateDeviceConfig(h, data);
+        }
+        else
         {
-            Thermometer *t = th.second;
-            if (t->Pin == ow.first)
+            DeviceValues &last = pool.Values(h);
+            isDeviceChanged = memcmp(&last, &values, sizeof(values)) != 0;
+            if (isDeviceChanged)
             {
-                bool isConnected = dt.isConnected(t->Address.addr);
-                if (isConnected)
-                {
-                    if (!t->Status)
-                    {
-                        t->Status = true;
-                        ThermometerEvent changes;
-                        changes.Event = UNIT_CONNECTION_RESTORED;
-                        strncpy(changes.Name, t->Name.c_str(), sizeof(changes.Name));
-                        changes.Address = t->Address;
-                        changes.Pin = t->Pin;
-                        changes.OldName[0] = 0;
-                        OneWireMgr.notifyThermometerChanges(&changes);
-                    }
-
-                    if (t->Status)
-                    {
-                        double temp = dt.getTempC(t->Address.addr);
-                        temp = round(temp * 10) / 10;
-                        if (t->Temperature != temp)
-                        {
-                            t->Temperature = temp;
-                            TemperatureEvent changes;
-                            strncpy(changes.Name, t->Name.c_str(), sizeof(changes.Name));
-                            changes.Temperature = t->Temperature;
-                            OneWireMgr.notifyTemperatureChanges(&changes);
-                        }
-
-                        dt.requestTemperaturesByAddress(t->Address.addr);
-                    }
-                }
-                else
-                {
-                    if (t->Status)
-                    {
-                        t->Status = false;
-                        ThermometerEvent changes;
-                        changes.Event = UNIT_CONNECTION_LOST;
-                        strncpy(changes.Name, t->Name.c_str(), sizeof(changes.Name));
-                        changes.Address = t->Address;
-                        changes.Pin = t->Pin;
-                        changes.OldName[0] = 0;
-                        OneWireMgr.notifyThermometerChanges(&changes);
-                    }
-                }
+                strncpy(device.Name, t->Name, sizeof(device.Name));
+                device.Address = t->Address;
+                device.Pin = t->Pin;
+                device.Values = values;
+            }
+        }
+        pool.Values(h) = values;
+        if (isThermometer)
+        {
+            t->Temperature = temp;
+            if (isToPost(h, temp, t->LastRead))
+            {
+                isTemperatureChanged = true;
+                strncpy(temperature.Name, t->Name, sizeof(temperature.Name));
+                temperature.Temperature = t->Temperature;
             }
         }
-        xTimerReset(OneWireMgr.temperatureLoopTimer, 0);
+    }
+    else
+    {
+        // quarantine: the lost device is probed less and less often, the cycles of the others are not slowed
+        quarantine(h);
+        if (t->Status)
+        {
+            t->Status = false;
+            isChanged = true;
+            changes.Event = UNIT_CONNECTION_LOST;
+            stats.Lost++;
+            unit.Stats.Lost++;
+        }
+    }
+    if (isChanged)
+    {
+        strncpy(changes.Name, t->Name, sizeof(changes.Name));
+        changes.Address = t->Address;
+        changes.Pin = t->Pin;
+        changes.OldName[0] = 0;
+    }
+    bool hasRequest = s.HasRequest;
+    pool.Publish(h);
+    xSemaphoreGiveRecursive(lock);
+
+    if (isChanged)
+    {
+        notifyThermometerChanges(&changes);
+    }
+    if (isTemperatureChanged)
+    {
+        publishTemperature(unit, h, temperature);
+    }
+    if (isDeviceChanged)
+    {
+        notifyDeviceChanges(h, &device);
+    }
+    if (hasRequest)
+    {
+        completeDeviceReads(unit, h, status == SCRATCHPAD_OK);
     }
 }
-void Async1WireMgr::requestTemperature()
+
+bool Async1WireMgr::isToPost(ThermometerHandle h, double temperature, uint32_t now)
 {
-    for (auto &ow : OneWireMgr.oneWireCollection)
+    PostedTemperature &posted = pool.Posted(h);
+    const TemperatureFilter &f = posted.HasFilter ? posted.Filter : filter;
+    int8_t direction = 0;
+    if (posted.IsPosted)
     {
-        OneWire *oneWire = ow.second;
-        DallasTemperature dt = DallasTemperature(oneWire);
-        for (auto &th : OneWireMgr.thermometers)
+        double delta = temperature - posted.Temperature;
+        direction = delta > 0 ? 1 : (delta < 0 ? -1 : 0);
+        bool isHeartbeat = f.Heartbeat > 0 && now - posted.Time >= f.Heartbeat;
+        if (!isHeartbeat)
         {
-            Thermometer *t = th.second;
-            if (t->Pin == ow.first)
+            if (direction == 0 || now - posted.Time < f.MinInterval)
             {
-                if (t->Status)
-                {
-                    dt.requestTemperaturesByAddress(t->Address.addr);
-                }
+                return false;
+            }
+            double threshold = f.Deadband;
+            if (direction == -posted.Direction)
+            {
+                threshold += f.Hysteresis;
+            }
+            // compare with a margin: the values are rounded to 0.1
+            if (fabs(delta) < threshold - 0.001)
+            {
+                return false;
             }
         }
     }
+    posted.IsPosted = true;
+    posted.Temperature = temperature;
+    posted.Time = now;
+    if (direction != 0)
+    {
+        posted.Direction = direction;
+    }
+    return true;
+}
+
+void Async1WireMgr::publishTemperature(OneWireBusUnit &unit, ThermometerHandle h, TemperatureEvent &temperature)
+{
+    if (!isBatch)
+    {
+        notifyTemperatureChanges(h, &temperature);
+        return;
+    }
+    if (unit.Batch.Count >= TEMPERATURE_BATCH_SIZE)
+    {
+        flushBatch(unit);
+    }
+    TemperatureReading &reading = unit.Batch.Readings[unit.Batch.Count++];
+    reading.Address = pool.Get(h).Address;
+    reading.Handle = h;
+    reading.Temperature = (float)temperature.Temperature;
+    reading.Timestamp = millis();
 }
+
+void Async1WireMgr::flushBatch(OneWireBusUnit &unit)
+{
+    if (unit.Batch.Count == 0)
+    {
+        return;
+    }
+    unit.Batch.Pin = unit.Pin;
+    size_t size = offsetof(TemperatureBatchEvent, Readings) + unit.Batch.Count * sizeof(TemperatureReading);
+    if (postToLoop(ONEWIRE_EVENT_TEMPERATURE_BATCH, &unit.Batch, size) != ESP_OK)
+    {
+        countDropped();
+    }
+    unit.Batch.Count = 0;
+}
+
 Address1Wire Async1WireMgr::ParseAddress(const char *addrStr)
 {
     Address1Wire addr;
@@ -387,5 +2331,7 @@ Address1Wire Async1WireMgr::ParseAddress(const char *addrStr)
 }
 
 //--------------------------------------------------------------------------
+#ifndef ASYNC1WIRE_NO_GLOBAL_MANAGER
 Async1WireMgr OneWireMgr;
+#endif
 ESP_EVENT_DEFINE_BASE(ONEWIRE_EVENT);
\ No newline at end of file
@@ -0,0 +1,175 @@
+#include "DS18x20.hpp"
+
+bool DS18x20::IsFamily(uint8_t family)
+{
+    return family == DS18S20MODEL || family == DS18B20MODEL || family == DS1822MODEL || family == DS1825MODEL ||
+           family == DS28EA00MODEL;
+}
+
+bool DS18x20::ReadScratchPad(OneWireBus *bus, const uint8_t *rom, uint8_t *scratchPad)
+{
+    if (!bus->reset())
+    {
+        return false;
+    }
+    bus->select(rom);
+    bus->write(DS18X20_READ_SCRATCHPAD);
+    bus->read_bytes(scratchPad, DS18X20_SCRATCHPAD_SIZE);
+    return bus->reset() == 1;
+}
+
+bool DS18x20::IsValidScratchPad(const uint8_t *scratchPad)
+{
+    bool allZeros = true;
+    for (uint8_t i = 0; i < DS18X20_SCRATCHPAD_SIZE; i++)
+    {
+        if (scratchPad[i] != 0)
+        {
+            allZeros = false;
+            break;
+        }
+    }
+    return !allZeros && OneWireBus::crc8(scratchPad, 8) == scratchPad[DS18X20_SCRATCHPAD_CRC];
+}
+
+ScratchPadStatus DS18x20::CheckScratchPad(const uint8_t *scratchPad)
+{
+    bool allZeros = true;
+    bool allOnes = true;
+    for (uint8_t i = 0; i < DS18X20_SCRATCHPAD_SIZE; i++)
+    {
+        allZeros = allZeros && scratchPad[i] == 0x00;
+        allOnes = allOnes && scratchPad[i] == 0xFF;
+    }
+    if (allZeros || allOnes)
+    {
+        return SCRATCHPAD_NO_DEVICE;
+    }
+    if (OneWireBus::crc8(scratchPad, 8) != scratchPad[DS18X20_SCRATCHPAD_CRC])
+    {
+        return SCRATCHPAD_CRC_ERROR;
+    }
+    return SCRATCHPAD_OK;
+}
+
+ScratchPadStatus DS18x20::ReadCheckedScratchPad(OneWireBus *bus, const uint8_t *rom, uint8_t *scratchPad)
+{
+    if (!ReadScratchPad(bus, rom, scratchPad))
+    {
+        // any device answers the reset, the addressed one or not
+        return SCRATCHPAD_NO_PRESENCE;
+    }
+    return CheckScratchPad(scratchPad);
+}
+
+bool DS18x20::IsConnected(OneWireBus *bus, const uint8_t *rom, uint8_t *scratchPad)
+{
+    return ReadScratchPad(bus, rom, scratchPad) && IsValidScratchPad(scratchPad);
+}
+
+void DS18x20::WriteScratchPad(OneWireBus *bus, const uint8_t *rom, const uint8_t *scratchPad, bool copyToEeprom,
+                              bool parasite)
+{
+    bus->reset();
+    bus->select(rom);
+    bus->write(DS18X20_WRITE_SCRATCHPAD);
+    bus->write(scratchPad[DS18X20_HIGH_ALARM_TEMP]);
+    bus->write(scratchPad[DS18X20_LOW_ALARM_TEMP]);
+    // DS18S20 has no configuration register
+    if (rom[0] != DS18S20MODEL)
+    {
+        bus->write(scratchPad[DS18X20_CONFIGURATION]);
+    }
+    bus->reset();
+    if (copyToEeprom)
+    {
+        bus->select(rom);
+        bus->write(DS18X20_COPY_SCRATCHPAD, parasite);
+        // NV write cycle is 10ms max, some clones need more
+        delay(20);
+        if (parasite)
+        {
+            bus->depower();
+        }
+        bus->reset();
+    }
+}
+
+bool DS18x20::ReadPowerSupply(OneWireBus *bus, const uint8_t *rom)
+{
+    if (!bus->reset())
+    {
+        return false;
+    }
+    if (rom == nullptr)
+    {
+        bus->skip();
+    }
+    else
+    {
+        bus->select(rom);
+    }
+    bus->write(DS18X20_READ_POWER_SUPPLY);
+    bool parasite = (bus->read_bit() == 0);
+    bus->reset();
+    return parasite;
+}
+
+bool DS18x20::StartConversion(OneWireBus *bus, const uint8_t *rom, bool parasite)
+{
+    if (!bus->reset())
+    {
+        return false;
+    }
+    if (rom == nullptr)
+    {
+        bus->skip();
+    }
+    else
+    {
+        bus->select(rom);
+    }
+    bus->write(DS18X20_CONVERT_T, parasite);
+    return true;
+}
+
+int32_t DS18x20::CalculateRaw(const uint8_t *rom, const uint8_t *scratchPad)
+{
+    int32_t neg = 0;
+    if (scratchPad[DS18X20_TEMP_MSB] & 0x80)
+    {
+        neg = (int32_t)0xFFF80000;
+    }
+    int32_t raw = (((int32_t)scratchPad[DS18X20_TEMP_MSB]) << 11) | (((int32_t)scratchPad[DS18X20_TEMP_LSB]) << 3) | neg;
+
+    // DS18S20 has 9 bit resolution, the extended one is calculated from COUNT_REMAIN
+    if (rom[0] == DS18S20MODEL && scratchPad[DS18X20_COUNT_PER_C] != 0)
+    {
+        raw = (((raw & 0xfff0) << 3) - 32 +
+               (((scratchPad[DS18X20_COUNT_PER_C] - scratchPad[DS18X20_COUNT_REMAIN]) << 7) /
+                scratchPad[DS18X20_COUNT_PER_C])) |
+              neg;
+    }
+    return raw;
+}
+
+uint8_t DS18x20::GetResolution(const uint8_t *rom, const uint8_t *scratchPad)
+{
+    if (rom[0] == DS18S20MODEL)
+    {
+        return 12;
+    }
+    return ((scratchPad[DS18X20_CONFIGURATION] >> 5) & 0x03) + 9;
+}
+
+uint8_t DS18x20::ResolutionToConfig(uint8_t resolution)
+{
+    resolution = constrain(resolution, 9, 12);
+    return (uint8_t)(((resolution - 9) << 5) | 0x1F);
+}
+
+uint32_t DS18x20::ConversionTimeMicros(uint8_t resolution)
+{
+    resolution = resolution == 0 ? 12 : constrain(resolution, 9, 12);
+    return 93750UL << (resolution - 9);
+}
@@ -0,0 +1,43 @@
+#include "DeadlineQueue.hpp"
+
+bool DeadlineQueue::Push(uint32_t due, uint8_t priority, ThermometerHandle handle)
+{
+    if (size >= DEADLINE_QUEUE_SIZE)
+    {
+        return false;
+    }
+    int i = size++;
+    Entry e = {due, priority, handle};
+    while (i > 0 && isHigher(e, entries[(i - 1) / 2]))
+    {
+        entries[i] = entries[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    entries[i] = e;
+    return true;
+}
+
+void DeadlineQueue::Pop()
+{
+    Entry last = entries[--size];
+    int i = 0;
+    for (;;)
+    {
+        int child = 2 * i + 1;
+        if (child >= size)
+        {
+            break;
+        }
+        if (child + 1 < size && isHigher(entries[child + 1], entries[child]))
+        {
+            child++;
+        }
+        if (!isHigher(entries[child], last))
+        {
+            break;
+        }
+        entries[i] = entries[child];
+        i = child;
+    }
+    entries[i] = last;
+}
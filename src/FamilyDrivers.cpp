@@ -0,0 +1,112 @@
+#include "FamilyDrivers.hpp"
+
+ScratchPadStatus DS2438Driver::Read(OneWireBus *bus, const uint8_t *rom, uint8_t *data)
+{
+    // the results of the conversions are in page 0 of the memory: copied to the scratchpad, then read
+    if (!bus->reset())
+    {
+        return SCRATCHPAD_NO_PRESENCE;
+    }
+    bus->select(rom);
+    bus->write(DS2438_RECALL_MEMORY);
+    bus->write(0);
+    if (!bus->reset())
+    {
+        return SCRATCHPAD_NO_PRESENCE;
+    }
+    bus->select(rom);
+    bus->write(DS2438_READ_SCRATCHPAD);
+    bus->write(0);
+    bus->read_bytes(data, DS2438_PAGE_SIZE);
+    if (!bus->reset())
+    {
+        return SCRATCHPAD_NO_PRESENCE;
+    }
+    ScratchPadStatus status = DS18x20::CheckScratchPad(data);
+    if (status == SCRATCHPAD_OK)
+    {
+        // the voltage for the next read: converted while the bus waits for the next cycle
+        bus->select(rom);
+        bus->write(DS2438_CONVERT_V);
+    }
+    return status;
+}
+
+void DS2438Driver::Decode(const uint8_t * /*rom*/, const uint8_t *data, DeviceValues &values)
+{
+    values.Count = 3;
+    // 1/32 degree in the upper 13 bits
+    values.Values[0] = (int16_t)(data[DS2438_TEMP_MSB] << 8 | data[DS2438_TEMP_LSB]) / 256.0f;
+    // 10 mV
+    values.Values[1] = ((data[DS2438_VOLTAGE_MSB] & 0x03) << 8 | data[DS2438_VOLTAGE_LSB]) * 0.01f;
+    values.Values[2] = (int16_t)(data[DS2438_CURRENT_MSB] << 8 | data[DS2438_CURRENT_LSB]);
+}
+
+ScratchPadStatus DS2408Driver::Read(OneWireBus *bus, const uint8_t *rom, uint8_t *data)
+{
+    if (!bus->reset())
+    {
+        return SCRATCHPAD_NO_PRESENCE;
+    }
+    const uint8_t command[3] = {DS2408_READ_PIO_REGISTERS, DS2408_PIO_LOGIC_STATE, 0};
+    bus->select(rom);
+    bus->write_bytes(command, sizeof(command));
+    bus->read_bytes(data, DS2408_REGISTERS_SIZE + 2);
+    if (!bus->reset())
+    {
+        return SCRATCHPAD_NO_PRESENCE;
+    }
+    bool allZeros = true;
+    bool allOnes = true;
+    for (uint8_t i = 0; i < DS2408_REGISTERS_SIZE + 2; i++)
+    {
+        allZeros = allZeros && data[i] == 0x00;
+        allOnes = allOnes && data[i] == 0xFF;
+    }
+    if (allZeros || allOnes)
+    {
+        return SCRATCHPAD_NO_DEVICE;
+    }
+    // the CRC covers the command and the address too
+    uint16_t crc = OneWireBus::crc16(data, DS2408_REGISTERS_SIZE, OneWireBus::crc16(command, sizeof(command)));
+    uint16_t received = data[DS2408_REGISTERS_SIZE] | data[DS2408_REGISTERS_SIZE + 1] << 8;
+    return (uint16_t)~crc == received ? SCRATCHPAD_OK : SCRATCHPAD_CRC_ERROR;
+}
+
+void DS2408Driver::Decode(const uint8_t * /*rom*/, const uint8_t *data, DeviceValues &values)
+{
+    values.Count = 3;
+    values.Values[0] = data[0];
+    values.Values[1] = data[1];
+    values.Values[2] = data[2];
+}
+
+ScratchPadStatus DS2413Driver::Read(OneWireBus *bus, const uint8_t *rom, uint8_t *data)
+{
+    if (!bus->reset())
+    {
+        return SCRATCHPAD_NO_PRESENCE;
+    }
+    bus->select(rom);
+    bus->write(DS2413_PIO_ACCESS_READ);
+    data[0] = bus->read();
+    if (!bus->reset())
+    {
+        return SCRATCHPAD_NO_PRESENCE;
+    }
+    if (data[0] == 0x00 || data[0] == 0xFF)
+    {
+        return SCRATCHPAD_NO_DEVICE;
+    }
+    // the upper nibble is the complement of the lower one
+    return (data[0] >> 4) == (~data[0] & 0x0F) ? SCRATCHPAD_OK : SCRATCHPAD_CRC_ERROR;
+}
+
+void DS2413Driver::Decode(const uint8_t * /*rom*/, const uint8_t *data, DeviceValues &values)
+{
+    values.Count = 4;
+    values.Values[0] = data[0] & 0x01;
+    values.Values[1] = (data[0] >> 2) & 0x01;
+    values.Values[2] = (data[0] >> 1) & 0x01;
+    values.Values[3] = (data[0] >> 3) & 0x01;
+}
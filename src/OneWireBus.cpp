@@ -0,0 +1,238 @@
+#include "OneWireBus.hpp"
+
+void OneWireBus::write(uint8_t v, uint8_t power)
+{
+    for (uint8_t bitMask = 0x01; bitMask; bitMask <<= 1)
+    {
+        write_bit((bitMask & v) ? 1 : 0);
+    }
+    if (!power)
+    {
+        depower();
+    }
+}
+
+uint8_t OneWireBus::read()
+{
+    uint8_t r = 0;
+    for (uint8_t bitMask = 0x01; bitMask; bitMask <<= 1)
+    {
+        if (read_bit())
+        {
+            r |= bitMask;
+        }
+    }
+    return r;
+}
+
+void OneWireBus::write_bytes(const uint8_t *buf, uint16_t count, bool power)
+{
+    for (uint16_t i = 0; i < count; i++)
+    {
+        write(buf[i], 1);
+    }
+    if (!power)
+    {
+        depower();
+    }
+}
+
+void OneWireBus::read_bytes(uint8_t *buf, uint16_t count)
+{
+    for (uint16_t i = 0; i < count; i++)
+    {
+        buf[i] = read();
+    }
+}
+
+void OneWireBus::select(const uint8_t rom[8])
+{
+    write(0x55);
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        write(rom[i]);
+    }
+}
+
+void OneWireBus::skip()
+{
+    write(0xCC);
+}
+
+void OneWireBus::reset_search()
+{
+    LastDiscrepancy = 0;
+    LastDeviceFlag = false;
+    LastFamilyDiscrepancy = 0;
+    for (int i = 7; i >= 0; i--)
+    {
+        ROM_NO[i] = 0;
+    }
+}
+
+void OneWireBus::target_search(uint8_t family_code)
+{
+    ROM_NO[0] = family_code;
+    for (uint8_t i = 1; i < 8; i++)
+    {
+        ROM_NO[i] = 0;
+    }
+    LastDiscrepancy = 64;
+    LastFamilyDiscrepancy = 0;
+    LastDeviceFlag = false;
+}
+
+void OneWireBus::get_search_state(OneWireSearchState &state) const
+{
+    memcpy(state.Rom, ROM_NO, sizeof(state.Rom));
+    state.LastDiscrepancy = LastDiscrepancy;
+    state.LastFamilyDiscrepancy = LastFamilyDiscrepancy;
+    state.LastDeviceFlag = LastDeviceFlag;
+}
+
+void OneWireBus::set_search_state(const OneWireSearchState &state)
+{
+    memcpy(ROM_NO, state.Rom, sizeof(ROM_NO));
+    LastDiscrepancy = state.LastDiscrepancy;
+    LastFamilyDiscrepancy = state.LastFamilyDiscrepancy;
+    LastDeviceFlag = state.LastDeviceFlag;
+}
+
+// Maxim application note 187
+bool OneWireBus::search(uint8_t *newAddr, bool search_mode)
+{
+    uint8_t id_bit_number = 1;
+    uint8_t last_zero = 0;
+    uint8_t rom_byte_number = 0;
+    uint8_t rom_byte_mask = 1;
+    bool search_result = false;
+
+    if (!LastDeviceFlag)
+    {
+        if (!reset())
+        {
+            reset_search();
+            return false;
+        }
+
+        write(search_mode ? 0xF0 : 0xEC);
+
+        do
+        {
+            uint8_t id_bit = read_bit();
+            uint8_t cmp_id_bit = read_bit();
+            uint8_t search_direction;
+
+            if (id_bit == 1 && cmp_id_bit == 1)
+            {
+                break;
+            }
+            if (id_bit != cmp_id_bit)
+            {
+                search_direction = id_bit;
+            }
+            else
+            {
+                if (id_bit_number < LastDiscrepancy)
+                {
+                    search_direction = ((ROM_NO[rom_byte_number] & rom_byte_mask) > 0);
+                }
+                else
+                {
+                    search_direction = (id_bit_number == LastDiscrepancy);
+                }
+                if (search_direction == 0)
+                {
+                    last_zero = id_bit_number;
+                    if (last_zero < 9)
+                    {
+                        LastFamilyDiscrepancy = last_zero;
+                    }
+                }
+            }
+
+            if (search_direction == 1)
+            {
+                ROM_NO[rom_byte_number] |= rom_byte_mask;
+            }
+            else
+            {
+                ROM_NO[rom_byte_number] &= ~rom_byte_mask;
+            }
+            write_bit(search_direction);
+
+            id_bit_number++;
+            rom_byte_mask <<= 1;
+            if (rom_byte_mask == 0)
+            {
+                rom_byte_number++;
+                rom_byte_mask = 1;
+            }
+        } while (rom_byte_number < 8);
+
+        if (id_bit_number >= 65)
+        {
+            LastDiscrepancy = last_zero;
+            if (LastDiscrepancy == 0)
+            {
+                LastDeviceFlag = true;
+            }
+            search_result = true;
+        }
+    }
+
+    if (!search_result || !ROM_NO[0])
+    {
+        LastDiscrepancy = 0;
+        LastDeviceFlag = false;
+        LastFamilyDiscrepancy = 0;
+        search_result = false;
+    }
+    else
+    {
+        for (int i = 0; i < 8; i++)
+        {
+            newAddr[i] = ROM_NO[i];
+        }
+    }
+    return search_result;
+}
+
+uint8_t OneWireBus::crc8(const uint8_t *addr, uint8_t len)
+{
+    uint8_t crc = 0;
+    while (len--)
+    {
+        uint8_t inbyte = *addr++;
+        for (uint8_t i = 8; i; i--)
+        {
+            uint8_t mix = (crc ^ inbyte) & 0x01;
+            crc >>= 1;
+            if (mix)
+            {
+                crc ^= 0x8C;
+            }
+            inbyte >>= 1;
+        }
+    }
+    return crc;
+}
+
+uint16_t OneWireBus::crc16(const uint8_t *input, uint16_t len, uint16_t crc)
+{
+    static const uint8_t oddParity[16] = {0, 1, 1, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0, 1, 1, 0};
+    for (uint16_t i = 0; i < len; i++)
+    {
+        uint16_t data = (input[i] ^ crc) & 0xFF;
+        crc >>= 8;
+        if (oddParity[data & 0x0F] ^ oddParity[data >> 4])
+        {
+            crc ^= 0xC001;
+        }
+        data <<= 6;
+        crc ^= data;
+        data <<= 1;
+        crc ^= data;
+    }
+    return crc;
+}
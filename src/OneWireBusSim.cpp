@@ -0,0 +1,757 @@
+#include "OneWireBusSim.hpp"
+#include "DS18x20.hpp"
+#include "FamilyDrivers.hpp"
+#ifdef ARDUINO
+#include <esp_timer.h>
+#endif
+
+// Power-on value of the temperature register
+#define SIM_POWER_ON_TEMPERATURE 85.0f
+
+static uint64_t packRom(const uint8_t *rom)
+{
+    uint64_t v = 0;
+    memcpy(&v, rom, 8);
+    return v;
+}
+
+uint8_t OneWireBusSim::reset()
+{
+    spend(SIM_RESET_MICROS);
+    resets++;
+    releasePullup();
+    bitIndex = 0;
+    rxByte = 0;
+    allSelected = true;
+    selected.clear();
+    if (connectedDevices == 0)
+    {
+        state = SIM_IDLE;
+        return 0;
+    }
+    state = SIM_ROM_COMMAND;
+    return 1;
+}
+
+void OneWireBusSim::write_bit(uint8_t v)
+{
+    spend(v ? SIM_WRITE_ONE_MICROS : SIM_WRITE_ZERO_MICROS);
+    slots++;
+    releasePullup();
+    switch (state)
+    {
+    case SIM_ROM_COMMAND:
+    case SIM_FUNCTION_COMMAND:
+    case SIM_FUNCTION_ARGS:
+    case SIM_WRITE_SCRATCHPAD:
+    {
+        if (v)
+        {
+            rxByte |= (1 << bitIndex);
+        }
+        bitIndex++;
+        if (bitIndex == 8)
+        {
+            uint8_t b = rxByte;
+            bitIndex = 0;
+            rxByte = 0;
+            if (state == SIM_ROM_COMMAND)
+            {
+                onRomCommand(b);
+            }
+            else if (state == SIM_FUNCTION_COMMAND)
+            {
+                onFunctionCommand(b);
+            }
+            else if (state == SIM_FUNCTION_ARGS)
+            {
+                args[argCount++] = b;
+                if (argCount == argsNeeded)
+                {
+                    onFunctionArgs();
+                }
+            }
+            else
+            {
+                for (size_t i = 0; i < selected.size(); i++)
+                {
+                    SimDevice &d = devices[selected[i]];
+                    if (byteIndex == 0)
+                    {
+                        d.ScratchPad[DS18X20_HIGH_ALARM_TEMP] = b;
+                    }
+                    else if (byteIndex == 1)
+                    {
+                        d.ScratchPad[DS18X20_LOW_ALARM_TEMP] = b;
+                    }
+                    else if (byteIndex == 2 && d.Rom[0] != DS18S20MODEL)
+                    {
+                        d.ScratchPad[DS18X20_CONFIGURATION] = (b & 0x60) | 0x1F;
+                    }
+                    updateCrc(d);
+                }
+                byteIndex++;
+            }
+        }
+    }
+    break;
+    case SIM_MATCH_ROM:
+    {
+        if (v)
+        {
+            romBits[bitIndex >> 3] |= (1 << (bitIndex & 7));
+        }
+        bitIndex++;
+        if (bitIndex == 64)
+        {
+            auto found = romIndex.find(packRom(romBits));
+            allSelected = false;
+            selected.clear();
+            if (found != romIndex.end() && devices[found->second].IsConnected)
+            {
+                selected.push_back(found->second);
+            }
+            state = SIM_FUNCTION_COMMAND;
+            bitIndex = 0;
+        }
+    }
+    break;
+    case SIM_SEARCH:
+    {
+        if (searchPhase != 2)
+        {
+            break;
+        }
+        size_t n = 0;
+        for (size_t i = 0; i < selected.size(); i++)
+        {
+            if (bitOf(devices[selected[i]].Rom, bitIndex) == v)
+            {
+                selected[n++] = selected[i];
+            }
+        }
+        selected.resize(n);
+        searchPhase = 0;
+        bitIndex++;
+        if (bitIndex == 64)
+        {
+            state = SIM_FUNCTION_COMMAND;
+            bitIndex = 0;
+        }
+    }
+    break;
+    default:
+        break;
+    }
+}
+
+uint8_t OneWireBusSim::read_bit()
+{
+    spend(SIM_READ_MICROS);
+    slots++;
+    releasePullup();
+    uint8_t r = 1;
+    switch (state)
+    {
+    case SIM_SEARCH:
+    {
+        // bit and complement bit, wired-AND of all devices still taking part
+        if (searchPhase > 1)
+        {
+            break;
+        }
+        for (size_t i = 0; i < selected.size(); i++)
+        {
+            if (bitOf(devices[selected[i]].Rom, bitIndex) == searchPhase)
+            {
+                r = 0;
+                break;
+            }
+        }
+        searchPhase++;
+    }
+    break;
+    case SIM_READ_ROM:
+    case SIM_READ_SCRATCHPAD:
+    {
+        uint8_t bits = (state == SIM_READ_ROM) ? 64 : 72;
+        if (bitIndex >= bits)
+        {
+            break;
+        }
+        for (size_t i = 0; i < selected.size(); i++)
+        {
+            const uint8_t *buf = (state == SIM_READ_ROM) ? devices[selected[i]].Rom : devices[selected[i]].ScratchPad;
+            r &= bitOf(buf, bitIndex);
+        }
+        if (corruptRead && bitIndex == DS18X20_SCRATCHPAD_CRC * 8)
+        {
+            r ^= 1;
+        }
+        bitIndex++;
+        if (state == SIM_READ_ROM && bitIndex == 64)
+        {
+            state = SIM_FUNCTION_COMMAND;
+            bitIndex = 0;
+        }
+    }
+    break;
+    case SIM_CONVERT:
+    {
+        for (size_t i = 0; i < selected.size(); i++)
+        {
+            SimDevice &d = devices[selected[i]];
+            settle(d);
+            if (d.IsConverting)
+            {
+                r = 0;
+            }
+        }
+    }
+    break;
+    case SIM_READ_POWER:
+    {
+        for (size_t i = 0; i < selected.size(); i++)
+        {
+            if (devices[selected[i]].IsParasitePowered)
+            {
+                r = 0;
+            }
+        }
+    }
+    break;
+    case SIM_READ_DATA:
+        if (bitIndex < readLength * 8)
+        {
+            r = bitOf(readBuffer, bitIndex++);
+        }
+        break;
+    default:
+        break;
+    }
+    return r;
+}
+
+uint8_t OneWireBusSim::TouchBit(uint8_t v)
+{
+    bool isWriting = state == SIM_ROM_COMMAND || state == SIM_FUNCTION_COMMAND || state == SIM_FUNCTION_ARGS ||
+                     state == SIM_WRITE_SCRATCHPAD || state == SIM_MATCH_ROM ||
+                     (state == SIM_SEARCH && searchPhase == 2);
+    if (v == 0 || isWriting)
+    {
+        write_bit(v);
+        return v;
+    }
+    return read_bit();
+}
+
+void OneWireBusSim::depower()
+{
+    releasePullup();
+}
+
+int OneWireBusSim::AddDevice(const uint8_t *rom, bool parasite)
+{
+    SimDevice d;
+    memcpy(d.Rom, rom, 7);
+    d.Rom[7] = crc8(d.Rom, 7);
+    d.IsParasitePowered = parasite;
+    d.IsConnected = true;
+    d.IsConverting = false;
+    d.IsAlarm = false;
+    d.ConversionEnd = 0;
+    d.Temperature = 25.0f;
+    d.CrcErrors = 0;
+    d.Eeprom[0] = 75; // TH
+    d.Eeprom[1] = 70; // TL
+    d.Eeprom[2] = 0x7F; // 12 bits
+    memset(d.ScratchPad, 0xFF, sizeof(d.ScratchPad));
+    d.ScratchPad[DS18X20_HIGH_ALARM_TEMP] = d.Eeprom[0];
+    d.ScratchPad[DS18X20_LOW_ALARM_TEMP] = d.Eeprom[1];
+    if (d.Rom[0] != DS18S20MODEL)
+    {
+        d.ScratchPad[DS18X20_CONFIGURATION] = d.Eeprom[2];
+    }
+    d.ScratchPad[DS18X20_COUNT_REMAIN] = 0x0C;
+    d.ScratchPad[DS18X20_COUNT_PER_C] = 0x10;
+    d.Voltage = 0;
+    memset(d.Memory, 0, sizeof(d.Memory));
+    if (d.Rom[0] == DS2438MODEL)
+    {
+        // IAD, CA, EE, AD: the voltage of VDD is measured
+        d.Memory[DS2438_STATUS] = 0x0F;
+    }
+    else if (d.Rom[0] == DS2408MODEL)
+    {
+        // the output latches are off, the pins are pulled up
+        d.Memory[0] = 0xFF;
+        d.Memory[1] = 0xFF;
+        d.Memory[6] = 0xFF;
+        d.Memory[7] = 0xFF;
+    }
+    d.Pio = d.Rom[0] == DS2413MODEL ? 0x03 : 0xFF;
+    latchPio(d);
+    latchTemperature(d, SIM_POWER_ON_TEMPERATURE);
+
+    devices.push_back(d);
+    romIndex[packRom(d.Rom)] = (int)devices.size() - 1;
+    connectedDevices++;
+    selected.reserve(devices.size());
+    return (int)devices.size() - 1;
+}
+
+int OneWireBusSim::AddDevice(uint8_t family, uint32_t serial, bool parasite)
+{
+    uint8_t rom[8] = {family, (uint8_t)serial, (uint8_t)(serial >> 8), (uint8_t)(serial >> 16), (uint8_t)(serial >> 24),
+                      0, 0, 0};
+    return AddDevice(rom, parasite);
+}
+
+void OneWireBusSim::InjectCrcErrors(int device, uint32_t count)
+{
+    devices[device].CrcErrors = count;
+}
+
+void OneWireBusSim::GetRom(int device, uint8_t *rom)
+{
+    memcpy(rom, devices[device].Rom, 8);
+}
+
+void OneWireBusSim::SetTemperature(int device, float temperature)
+{
+    devices[device].Temperature = temperature;
+}
+
+void OneWireBusSim::SetResolution(int device, uint8_t resolution)
+{
+    SimDevice &d = devices[device];
+    // DS18S20 has no configuration register
+    if (d.Rom[0] != DS18S20MODEL)
+    {
+        d.Eeprom[2] = DS18x20::ResolutionToConfig(resolution);
+        d.ScratchPad[DS18X20_CONFIGURATION] = d.Eeprom[2];
+        updateCrc(d);
+    }
+}
+
+void OneWireBusSim::SetVoltage(int device, float voltage)
+{
+    devices[device].Voltage = voltage;
+}
+
+void OneWireBusSim::SetPio(int device, uint8_t pio)
+{
+    devices[device].Pio = pio;
+    latchPio(devices[device]);
+}
+
+void OneWireBusSim::SetConnected(int device, bool connected)
+{
+    SimDevice &d = devices[device];
+    if (d.IsConnected != connected)
+    {
+        d.IsConnected = connected;
+        connectedDevices += connected ? 1 : -1;
+    }
+}
+
+void OneWireBusSim::ResetStatistics()
+{
+    busMicros = 0;
+    resets = 0;
+    slots = 0;
+}
+
+void OneWireBusSim::spend(uint32_t us)
+{
+    busMicros += us;
+#ifndef ARDUINO
+    HostPlatform::Advance(us);
+#endif
+}
+
+uint64_t OneWireBusSim::now()
+{
+#ifdef ARDUINO
+    return (uint64_t)esp_timer_get_time();
+#else
+    return HostPlatform::NowMicros();
+#endif
+}
+
+void OneWireBusSim::releasePullup()
+{
+    if (!pullup)
+    {
+        return;
+    }
+    pullup = false;
+    // parasite powered devices lose power when the pullup is released before the conversion is over
+    for (size_t i = 0; i < devices.size(); i++)
+    {
+        SimDevice &d = devices[i];
+        if (d.IsConverting && d.IsParasitePowered)
+        {
+            settle(d);
+            if (d.IsConverting)
+            {
+                d.IsConverting = false;
+                latchTemperature(d, SIM_POWER_ON_TEMPERATURE);
+            }
+        }
+    }
+}
+
+void OneWireBusSim::selectAll()
+{
+    if (!allSelected)
+    {
+        return;
+    }
+    allSelected = false;
+    selected.clear();
+    for (size_t i = 0; i < devices.size(); i++)
+    {
+        if (devices[i].IsConnected)
+        {
+            selected.push_back((int)i);
+        }
+    }
+}
+
+void OneWireBusSim::settle(SimDevice &d)
+{
+    if (d.IsConverting && now() >= d.ConversionEnd)
+    {
+        d.IsConverting = false;
+        latchTemperature(d, d.Temperature);
+    }
+}
+
+void OneWireBusSim::latchTemperature(SimDevice &d, float temperature)
+{
+    if (d.Rom[0] == DS2438MODEL)
+    {
+        // 1/32 degree in the upper 13 bits
+        int16_t raw = (int16_t)(lroundf(temperature * 32) * 8);
+        d.Memory[DS2438_TEMP_LSB] = (uint8_t)raw;
+        d.Memory[DS2438_TEMP_MSB] = (uint8_t)(raw >> 8);
+        return;
+    }
+    if (!DS18x20::IsFamily(d.Rom[0]))
+    {
+        return;
+    }
+    int16_t whole;
+    if (d.Rom[0] == DS18S20MODEL)
+    {
+        // 0.5 degree register, extended resolution through COUNT_REMAIN
+        int16_t halfDegrees = (int16_t)floorf(temperature * 2);
+        whole = halfDegrees >> 1;
+        int remain = 16 - (int)lroundf((temperature - whole + 0.25f) * 16);
+        d.ScratchPad[DS18X20_TEMP_LSB] = (uint8_t)halfDegrees;
+        d.ScratchPad[DS18X20_TEMP_MSB] = halfDegrees < 0 ? 0xFF : 0x00;
+        d.ScratchPad[DS18X20_COUNT_REMAIN] = (uint8_t)constrain(remain, 0, 16);
+    }
+    else
+    {
+        uint8_t resolution = DS18x20::GetResolution(d.Rom, d.ScratchPad);
+        int16_t raw = (int16_t)lroundf(temperature * 16);
+        raw &= ~((1 << (12 - resolution)) - 1);
+        whole = raw >> 4;
+        d.ScratchPad[DS18X20_TEMP_LSB] = (uint8_t)raw;
+        d.ScratchPad[DS18X20_TEMP_MSB] = (uint8_t)(raw >> 8);
+    }
+    d.IsAlarm = whole >= (int8_t)d.ScratchPad[DS18X20_HIGH_ALARM_TEMP] ||
+                whole <= (int8_t)d.ScratchPad[DS18X20_LOW_ALARM_TEMP];
+    updateCrc(d);
+}
+
+void OneWireBusSim::latchVoltage(SimDevice &d)
+{
+    // 10 mV
+    uint16_t voltage = (uint16_t)constrain(lroundf(d.Voltage * 100), 0, 1023);
+    d.Memory[DS2438_VOLTAGE_LSB] = (uint8_t)voltage;
+    d.Memory[DS2438_VOLTAGE_MSB] = (uint8_t)(voltage >> 8);
+}
+
+void OneWireBusSim::latchPio(SimDevice &d)
+{
+    if (d.Rom[0] == DS2408MODEL)
+    {
+        // logic state and the activity latch of the changed pins
+        d.Memory[2] |= d.Memory[0] ^ d.Pio;
+        d.Memory[0] = d.Pio;
+    }
+}
+
+void OneWireBusSim::updateCrc(SimDevice &d)
+{
+    d.ScratchPad[DS18X20_SCRATCHPAD_CRC] = crc8(d.ScratchPad, 8);
+}
+
+void OneWireBusSim::onRomCommand(uint8_t cmd)
+{
+    switch (cmd)
+    {
+    case 0x55: // Match ROM
+        state = SIM_MATCH_ROM;
+        memset(romBits, 0, sizeof(romBits));
+        break;
+    case 0xCC: // Skip ROM
+        state = SIM_FUNCTION_COMMAND;
+        break;
+    case 0xEC: // Alarm search
+    case 0xF0: // Search ROM
+    {
+        selectAll();
+        if (cmd == 0xEC)
+        {
+            size_t n = 0;
+            for (size_t i = 0; i < selected.size(); i++)
+            {
+                SimDevice &d = devices[selected[i]];
+                settle(d);
+                if (d.IsAlarm)
+                {
+                    selected[n++] = selected[i];
+                }
+            }
+            selected.resize(n);
+        }
+        state = SIM_SEARCH;
+        searchPhase = 0;
+    }
+    break;
+    case 0x33: // Read ROM
+        selectAll();
+        state = SIM_READ_ROM;
+        break;
+    default:
+        state = SIM_IDLE;
+        break;
+    }
+}
+
+uint8_t OneWireBusSim::selectedFamily()
+{
+    uint8_t family = selected.empty() ? 0 : devices[selected[0]].Rom[0];
+    for (size_t i = 1; i < selected.size(); i++)
+    {
+        if (devices[selected[i]].Rom[0] != family)
+        {
+            return 0;
+        }
+    }
+    return family;
+}
+
+bool OneWireBusSim::onDeviceCommand(uint8_t cmd)
+{
+    function = cmd;
+    argCount = 0;
+    switch (selectedFamily())
+    {
+    case DS2438MODEL:
+        if (cmd == DS2438_CONVERT_V)
+        {
+            for (size_t i = 0; i < selected.size(); i++)
+            {
+                latchVoltage(devices[selected[i]]);
+            }
+            state = SIM_DONE;
+            return true;
+        }
+        if (cmd == DS2438_RECALL_MEMORY || cmd == DS2438_READ_SCRATCHPAD)
+        {
+            argsNeeded = 1;
+            state = SIM_FUNCTION_ARGS;
+            return true;
+        }
+        // Convert T: as DS18x20
+        return false;
+    case DS2408MODEL:
+        argsNeeded = 2;
+        state = cmd == DS2408_READ_PIO_REGISTERS ? SIM_FUNCTION_ARGS : SIM_IDLE;
+        return true;
+    case DS2413MODEL:
+        state = SIM_IDLE;
+        if (cmd == DS2413_PIO_ACCESS_READ)
+        {
+            // the status byte is repeated until the reset
+            uint8_t status = 0xFF;
+            for (size_t i = 0; i < selected.size(); i++)
+            {
+                uint8_t pio = devices[selected[i]].Pio;
+                // the output latches are off
+                uint8_t low = (pio & 0x01) | 0x02 | (pio & 0x02) << 1 | 0x08;
+                status &= (uint8_t)(low | (~low << 4));
+            }
+            memset(readBuffer, status, sizeof(readBuffer));
+            readLength = sizeof(readBuffer);
+            state = SIM_READ_DATA;
+        }
+        return true;
+    default:
+        return false;
+    }
+}
+
+void OneWireBusSim::onFunctionArgs()
+{
+    state = SIM_DONE;
+    switch (function)
+    {
+    case DS2438_RECALL_MEMORY:
+        for (size_t i = 0; i < selected.size() && args[0] == 0; i++)
+        {
+            SimDevice &d = devices[selected[i]];
+            settle(d);
+            memcpy(d.ScratchPad, d.Memory, sizeof(d.Memory));
+            updateCrc(d);
+        }
+        break;
+    case DS2438_READ_SCRATCHPAD:
+        corruptRead = false;
+        for (size_t i = 0; i < selected.size(); i++)
+        {
+            SimDevice &d = devices[selected[i]];
+            if (d.CrcErrors > 0)
+            {
+                d.CrcErrors--;
+                corruptRead = true;
+            }
+        }
+        state = args[0] == 0 ? SIM_READ_SCRATCHPAD : SIM_DONE;
+        break;
+    case DS2408_READ_PIO_REGISTERS:
+    {
+        // only the whole register page is modelled
+        if (args[0] != DS2408_PIO_LOGIC_STATE || args[1] != 0)
+        {
+            break;
+        }
+        memset(readBuffer, 0xFF, sizeof(readBuffer));
+        bool isCorrupted = false;
+        for (size_t i = 0; i < selected.size(); i++)
+        {
+            SimDevice &d = devices[selected[i]];
+            for (uint8_t b = 0; b < DS2408_REGISTERS_SIZE; b++)
+            {
+                readBuffer[b] &= d.Memory[b];
+            }
+            if (d.CrcErrors > 0)
+            {
+                d.CrcErrors--;
+                isCorrupted = true;
+            }
+        }
+        uint8_t command[3] = {function, args[0], args[1]};
+        uint16_t crc = ~crc16(readBuffer, DS2408_REGISTERS_SIZE, crc16(command, sizeof(command)));
+        readBuffer[DS2408_REGISTERS_SIZE] = (uint8_t)crc ^ (isCorrupted ? 1 : 0);
+        readBuffer[DS2408_REGISTERS_SIZE + 1] = (uint8_t)(crc >> 8);
+        readLength = DS2408_REGISTERS_SIZE + 2;
+        state = SIM_READ_DATA;
+    }
+    break;
+    default:
+        break;
+    }
+}
+
+void OneWireBusSim::onFunctionCommand(uint8_t cmd)
+{
+    selectAll();
+    if (onDeviceCommand(cmd))
+    {
+        return;
+    }
+    if (cmd != DS18X20_CONVERT_T)
+    {
+        // the other families don't know the DS18x20 commands
+        size_t n = 0;
+        for (size_t i = 0; i < selected.size(); i++)
+        {
+            if (DS18x20::IsFamily(devices[selected[i]].Rom[0]))
+            {
+                selected[n++] = selected[i];
+            }
+        }
+        selected.resize(n);
+    }
+    switch (cmd)
+    {
+    case DS18X20_CONVERT_T:
+    {
+        uint64_t start = now();
+        for (size_t i = 0; i < selected.size(); i++)
+        {
+            SimDevice &d = devices[selected[i]];
+            uint32_t conversionTime = 750000;
+            if (d.Rom[0] == DS2438MODEL)
+            {
+                conversionTime = DS2438_CONVERSION_MICROS;
+            }
+            else if (!DS18x20::IsFamily(d.Rom[0]))
+            {
+                continue;
+            }
+            else if (d.Rom[0] != DS18S20MODEL)
+            {
+                conversionTime = DS18x20::ConversionTimeMicros(DS18x20::GetResolution(d.Rom, d.ScratchPad));
+            }
+            d.IsConverting = true;
+            d.ConversionEnd = start + conversionTime;
+        }
+        // the master keeps the strong pullup on (write(..., 1)) or releases it by the next call
+        pullup = true;
+        state = SIM_CONVERT;
+    }
+    break;
+    case DS18X20_READ_SCRATCHPAD:
+        corruptRead = false;
+        for (size_t i = 0; i < selected.size(); i++)
+        {
+            SimDevice &d = devices[selected[i]];
+            settle(d);
+            if (d.CrcErrors > 0)
+            {
+                d.CrcErrors--;
+                corruptRead = true;
+            }
+        }
+        state = SIM_READ_SCRATCHPAD;
+        break;
+    case DS18X20_WRITE_SCRATCHPAD:
+        state = SIM_WRITE_SCRATCHPAD;
+        byteIndex = 0;
+        break;
+    case DS18X20_COPY_SCRATCHPAD:
+        for (size_t i = 0; i < selected.size(); i++)
+        {
+            SimDevice &d = devices[selected[i]];
+            memcpy(d.Eeprom, &d.ScratchPad[DS18X20_HIGH_ALARM_TEMP], sizeof(d.Eeprom));
+        }
+        state = SIM_COPY_SCRATCHPAD;
+        break;
+    case DS18X20_RECALL_EEPROM:
+        for (size_t i = 0; i < selected.size(); i++)
+        {
+            SimDevice &d = devices[selected[i]];
+            memcpy(&d.ScratchPad[DS18X20_HIGH_ALARM_TEMP], d.Eeprom, sizeof(d.Eeprom));
+            if (d.Rom[0] == DS18S20MODEL)
+            {
+                d.ScratchPad[DS18X20_CONFIGURATION] = 0xFF;
+            }
+            updateCrc(d);
+        }
+        state = SIM_DONE;
+        break;
+    case DS18X20_READ_POWER_SUPPLY:
+        state = SIM_READ_POWER;
+        break;
+    default:
+        state = SIM_IDLE;
+        break;
+    }
+}
@@ -0,0 +1,176 @@
+#include "OneWireBusUart.hpp"
+#ifdef ARDUINO
+#include <driver/gpio.h>
+#endif
+
+void OneWireUartCodec::EncodeByte(uint8_t v, uint8_t *slots)
+{
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        slots[i] = EncodeBit((v >> i) & 0x01);
+    }
+}
+
+uint8_t OneWireUartCodec::DecodeByte(const uint8_t *echo)
+{
+    uint8_t r = 0;
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        r |= DecodeBit(echo[i]) << i;
+    }
+    return r;
+}
+
+UartResetResult OneWireUartCodec::DecodeReset(uint8_t echo)
+{
+    if (echo == ONEWIRE_UART_RESET_BYTE)
+    {
+        return UART_RESET_NO_PRESENCE;
+    }
+    // the presence pulse comes 15..60 us after the reset: it clears some of the high bits
+    return echo == 0x00 ? UART_RESET_SHORT : UART_RESET_PRESENCE;
+}
+
+void OneWireBusUart::begin(byte pin)
+{
+    port->Begin(pin);
+    baud = 0;
+    setBaudRate(ONEWIRE_UART_SLOT_BAUD);
+}
+
+uint8_t OneWireBusUart::reset()
+{
+    depower();
+    setBaudRate(ONEWIRE_UART_RESET_BAUD);
+    tx[0] = ONEWIRE_UART_RESET_BYTE;
+    bool isDone = port->Transfer(tx, rx, 1);
+    setBaudRate(ONEWIRE_UART_SLOT_BAUD);
+    lastReset = isDone ? OneWireUartCodec::DecodeReset(rx[0]) : UART_RESET_SHORT;
+    return lastReset == UART_RESET_PRESENCE ? 1 : 0;
+}
+
+void OneWireBusUart::write_bit(uint8_t v)
+{
+    tx[0] = OneWireUartCodec::EncodeBit(v);
+    transfer(1);
+}
+
+uint8_t OneWireBusUart::read_bit()
+{
+    tx[0] = ONEWIRE_UART_SLOT_ONE;
+    return transfer(1) ? OneWireUartCodec::DecodeBit(rx[0]) : 1;
+}
+
+void OneWireBusUart::depower()
+{
+    if (isPowered)
+    {
+        port->SetStrongPullup(false);
+        isPowered = false;
+    }
+}
+
+void OneWireBusUart::write(uint8_t v, uint8_t power)
+{
+    write_bytes(&v, 1, power);
+}
+
+uint8_t OneWireBusUart::read()
+{
+    uint8_t v;
+    read_bytes(&v, 1);
+    return v;
+}
+
+void OneWireBusUart::write_bytes(const uint8_t *buf, uint16_t count, bool power)
+{
+    while (count > 0)
+    {
+        uint16_t n = count < ONEWIRE_UART_CHUNK ? count : ONEWIRE_UART_CHUNK;
+        for (uint16_t i = 0; i < n; i++)
+        {
+            OneWireUartCodec::EncodeByte(buf[i], &tx[i * 8]);
+        }
+        transfer(n * 8);
+        buf += n;
+        count -= n;
+    }
+    if (power)
+    {
+        port->SetStrongPullup(true);
+        isPowered = true;
+    }
+}
+
+void OneWireBusUart::read_bytes(uint8_t *buf, uint16_t count)
+{
+    while (count > 0)
+    {
+        uint16_t n = count < ONEWIRE_UART_CHUNK ? count : ONEWIRE_UART_CHUNK;
+        memset(tx, ONEWIRE_UART_SLOT_ONE, n * 8);
+        bool isDone = transfer(n * 8);
+        for (uint16_t i = 0; i < n; i++)
+        {
+            // no echo reads as the idle line
+            buf[i] = isDone ? OneWireUartCodec::DecodeByte(&rx[i * 8]) : 0xFF;
+        }
+        buf += n;
+        count -= n;
+    }
+}
+
+void OneWireBusUart::setBaudRate(uint32_t baud)
+{
+    if (this->baud != baud)
+    {
+        port->SetBaudRate(baud);
+        this->baud = baud;
+    }
+}
+
+bool OneWireBusUart::transfer(uint16_t count)
+{
+    // the next time slot releases the strong pullup
+    depower();
+    return port->Transfer(tx, rx, count);
+}
+
+#ifdef ARDUINO
+void OneWireUartPortEsp::Begin(byte pin)
+{
+    this->pin = pin;
+    uart_config_t config = {};
+    config.baud_rate = (int)baud;
+    config.data_bits = UART_DATA_8_BITS;
+    config.parity = UART_PARITY_DISABLE;
+    config.stop_bits = UART_STOP_BITS_1;
+    config.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+    uart_driver_install(uart, 2 * ONEWIRE_UART_CHUNK * 8, 0, 0, NULL, 0);
+    uart_param_config(uart, &config);
+    uart_set_pin(uart, pin, pin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+    // TX and RX share the line: the devices can pull it low while TX is high
+    gpio_set_direction((gpio_num_t)pin, GPIO_MODE_INPUT_OUTPUT_OD);
+}
+
+void OneWireUartPortEsp::SetBaudRate(uint32_t baud)
+{
+    uart_wait_tx_done(uart, portMAX_DELAY);
+    uart_set_baudrate(uart, baud);
+    this->baud = baud;
+}
+
+bool OneWireUartPortEsp::Transfer(const uint8_t *tx, uint8_t *rx, uint16_t count)
+{
+    uart_flush_input(uart);
+    uart_write_bytes(uart, (const char *)tx, count);
+    // 10 bits per byte, plus a margin for the driver
+    TickType_t timeout = pdMS_TO_TICKS(count * 10 * 1000 / baud + 10);
+    return uart_read_bytes(uart, rx, count, timeout) == count;
+}
+
+void OneWireUartPortEsp::SetStrongPullup(bool isOn)
+{
+    // TX idles high: push-pull drives the line to the supply
+    gpio_set_direction((gpio_num_t)pin, isOn ? GPIO_MODE_INPUT_OUTPUT : GPIO_MODE_INPUT_OUTPUT_OD);
+}
+#endif
@@ -0,0 +1,25 @@
+#include "OneWireDriver.hpp"
+
+bool OneWireDriver::StartConversion(OneWireBus *bus, const uint8_t *rom, bool parasite)
+{
+    if (ConvertCommand() == 0 || !bus->reset())
+    {
+        return false;
+    }
+    if (rom == nullptr)
+    {
+        bus->skip();
+    }
+    else
+    {
+        bus->select(rom);
+    }
+    bus->write(ConvertCommand(), parasite);
+    return true;
+}
+
+void DS18x20Driver::Decode(const uint8_t *rom, const uint8_t *data, DeviceValues &values)
+{
+    values.Count = 1;
+    values.Values[0] = DS18x20::RawToCelsius(DS18x20::CalculateRaw(rom, data));
+}
@@ -0,0 +1,33 @@
+#include "OneWireStats.hpp"
+
+void AddLatency(LatencyHistogram &histogram, uint32_t micros)
+{
+    // floor(log2(micros))
+    uint32_t bucket = micros > 1 ? 31 - __builtin_clz(micros) : 0;
+    if (bucket >= STATS_HISTOGRAM_BUCKETS)
+    {
+        bucket = STATS_HISTOGRAM_BUCKETS - 1;
+    }
+    histogram.Buckets[bucket]++;
+    histogram.Count++;
+    histogram.Sum += micros;
+    if (micros > histogram.Max)
+    {
+        histogram.Max = micros;
+    }
+}
+
+uint32_t LatencyPercentile(const LatencyHistogram &histogram, double share)
+{
+    uint32_t limit = (uint32_t)(histogram.Count * share);
+    uint32_t count = 0;
+    for (uint8_t i = 0; i < STATS_HISTOGRAM_BUCKETS - 1; i++)
+    {
+        count += histogram.Buckets[i];
+        if (count > limit || (count == histogram.Count && count > 0))
+        {
+            return (2u << i) < histogram.Max ? (2u << i) : histogram.Max;
+        }
+    }
+    return histogram.Max;
+}
@@ -0,0 +1,146 @@
+#include "TemperatureHistory.hpp"
+
+TemperatureHistory::TemperatureHistory(HistorySample *samples, uint16_t *queues, uint16_t capacity)
+{
+    this->samples = samples;
+    this->queues = queues;
+    this->capacity = capacity;
+    memset(windows, 0, sizeof(windows));
+    for (uint8_t i = 0; i < HISTORY_WINDOWS; i++)
+    {
+        windows[i].Tail = 1;
+    }
+}
+
+bool TemperatureHistory::SetWindow(uint8_t index, uint32_t window)
+{
+    if (index >= HISTORY_WINDOWS)
+    {
+        return false;
+    }
+    Window &w = windows[index];
+    memset(&w, 0, sizeof(w));
+    w.Length = window;
+    w.Tail = oldestSequence();
+    if (window != 0)
+    {
+        for (uint32_t sequence = w.Tail; sequence <= lastSequence; sequence++)
+        {
+            addToWindow(index, sequence);
+        }
+    }
+    return true;
+}
+
+void TemperatureHistory::Add(uint32_t timestamp, int16_t raw, SampleStatus status)
+{
+    uint32_t sequence = lastSequence + 1;
+    if (sequence > capacity)
+    {
+        // the oldest sample is overwritten: it leaves the windows first
+        for (uint8_t i = 0; i < HISTORY_WINDOWS; i++)
+        {
+            while (windows[i].Length != 0 && windows[i].Tail <= sequence - capacity)
+            {
+                dropFromWindow(i);
+            }
+        }
+    }
+    HistorySample &sample = samples[positionOf(sequence)];
+    sample.Sequence = sequence;
+    sample.Timestamp = timestamp;
+    sample.Raw = status == SAMPLE_OK ? raw : 0;
+    sample.Status = status;
+    lastSequence = sequence;
+    for (uint8_t i = 0; i < HISTORY_WINDOWS; i++)
+    {
+        if (windows[i].Length != 0)
+        {
+            addToWindow(i, sequence);
+        }
+    }
+}
+
+void TemperatureHistory::addToWindow(uint8_t index, uint32_t sequence)
+{
+    Window &w = windows[index];
+    uint16_t position = positionOf(sequence);
+    const HistorySample &sample = samples[position];
+    if (sample.Status == SAMPLE_OK)
+    {
+        w.Sum += sample.Raw;
+        w.Count++;
+        // the samples which are neither older nor lower can't be the minimum any more
+        uint16_t *queue = minQueue(index);
+        while (w.MinCount > 0 && samples[queue[(w.MinHead + w.MinCount - 1) % capacity]].Raw >= sample.Raw)
+        {
+            w.MinCount--;
+        }
+        queue[(w.MinHead + w.MinCount++) % capacity] = position;
+        queue = maxQueue(index);
+        while (w.MaxCount > 0 && samples[queue[(w.MaxHead + w.MaxCount - 1) % capacity]].Raw <= sample.Raw)
+        {
+            w.MaxCount--;
+        }
+        queue[(w.MaxHead + w.MaxCount++) % capacity] = position;
+    }
+    while (w.Tail < sequence && sample.Timestamp - samples[positionOf(w.Tail)].Timestamp >= w.Length)
+    {
+        dropFromWindow(index);
+    }
+}
+
+void TemperatureHistory::dropFromWindow(uint8_t index)
+{
+    Window &w = windows[index];
+    uint16_t position = positionOf(w.Tail++);
+    const HistorySample &sample = samples[position];
+    if (sample.Status != SAMPLE_OK)
+    {
+        return;
+    }
+    w.Sum -= sample.Raw;
+    w.Count--;
+    // the queues are in the order of the samples: the oldest sample can only be at the front
+    if (w.MinCount > 0 && minQueue(index)[w.MinHead] == position)
+    {
+        w.MinHead = (w.MinHead + 1) % capacity;
+        w.MinCount--;
+    }
+    if (w.MaxCount > 0 && maxQueue(index)[w.MaxHead] == position)
+    {
+        w.MaxHead = (w.MaxHead + 1) % capacity;
+        w.MaxCount--;
+    }
+}
+
+bool TemperatureHistory::GetAggregate(uint8_t index, HistoryAggregate &aggregate)
+{
+    if (index >= HISTORY_WINDOWS)
+    {
+        return false;
+    }
+    Window &w = windows[index];
+    memset(&aggregate, 0, sizeof(aggregate));
+    aggregate.Window = w.Length;
+    if (w.Length == 0 || w.Count == 0)
+    {
+        return true;
+    }
+    aggregate.Count = w.Count;
+    aggregate.Min = samples[minQueue(index)[w.MinHead]].Raw / 16.0f;
+    aggregate.Max = samples[maxQueue(index)[w.MaxHead]].Raw / 16.0f;
+    aggregate.Mean = (float)w.Sum / w.Count / 16.0f;
+    return true;
+}
+
+uint16_t TemperatureHistory::ReadSince(uint32_t sequence, HistorySample *samples, uint16_t size)
+{
+    uint32_t first = sequence + 1 > oldestSequence() ? sequence + 1 : oldestSequence();
+    uint16_t count = 0;
+    for (uint32_t s = first; s <= lastSequence && count < size; s++)
+    {
+        samples[count++] = this->samples[positionOf(s)];
+    }
+    return count;
+}
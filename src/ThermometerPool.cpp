@@ -0,0 +1,188 @@
+#include "ThermometerPool.hpp"
+
+ThermometerPool::ThermometerPool() : count(0)
+{
+    for (int i = 0; i < MAX_THERMOMETERS; i++)
+    {
+        addressBuckets[i] = NO_THERMOMETER;
+        nameBuckets[i] = NO_THERMOMETER;
+    }
+    for (int i = 0; i < MAX_ONEWIRE_BUSES; i++)
+    {
+        firstOnBus[i] = NO_THERMOMETER;
+        lastOnBus[i] = NO_THERMOMETER;
+    }
+}
+
+ThermometerHandle ThermometerPool::Add(Address1Wire addr, const char *name)
+{
+    int n = count.load(std::memory_order_relaxed);
+    if (n >= MAX_THERMOMETERS)
+    {
+        return NO_THERMOMETER;
+    }
+    ThermometerHandle h = (ThermometerHandle)n;
+    ThermometerRecord &r = records[h];
+    memset(&r.Data, 0, sizeof(r.Data));
+    strncpy(r.Data.Name, name, LENGTH_OF_NAME - 1);
+    r.Data.Address = addr;
+    r.Bus = NO_BUS;
+    r.SearchId = 0;
+    memset(&r.Config, 0, sizeof(r.Config));
+    memset(&r.Posted, 0, sizeof(r.Posted));
+    memset(&r.Schedule, 0, sizeof(r.Schedule));
+    memset(&r.Stats, 0, sizeof(r.Stats));
+    r.History = nullptr;
+    memset(&r.Values, 0, sizeof(r.Values));
+    r.NextOnBus = NO_THERMOMETER;
+    r.Sequence.store(0, std::memory_order_relaxed);
+    Publish(h);
+
+    uint32_t bucket = hashAddress(addr) % MAX_THERMOMETERS;
+    r.NextByAddress = addressBuckets[bucket];
+    addressBuckets[bucket] = h;
+    linkName(h);
+    // the record is complete before it is counted: the snapshot readers don't take the lock
+    count.store(n + 1, std::memory_order_release);
+    return h;
+}
+
+ThermometerHandle ThermometerPool::Find(Address1Wire addr)
+{
+    ThermometerHandle h = addressBuckets[hashAddress(addr) % MAX_THERMOMETERS];
+    while (h != NO_THERMOMETER && records[h].Data.Address.packedAddress != addr.packedAddress)
+    {
+        h = records[h].NextByAddress;
+    }
+    return h;
+}
+
+ThermometerHandle ThermometerPool::FindByName(const char *name)
+{
+    ThermometerHandle h = nameBuckets[hashName(name) % MAX_THERMOMETERS];
+    while (h != NO_THERMOMETER && strncmp(records[h].Data.Name, name, LENGTH_OF_NAME - 1) != 0)
+    {
+        h = records[h].NextByName;
+    }
+    return h;
+}
+
+void ThermometerPool::Rename(ThermometerHandle h, const char *name)
+{
+    unlinkName(h);
+    Thermometer &t = records[h].Data;
+    strncpy(t.Name, name, LENGTH_OF_NAME - 1);
+    t.Name[LENGTH_OF_NAME - 1] = 0;
+    linkName(h);
+    Publish(h);
+}
+
+void ThermometerPool::Publish(ThermometerHandle h)
+{
+    ThermometerRecord &r = records[h];
+    uint32_t seq = r.Sequence.load(std::memory_order_relaxed);
+    r.Sequence.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(r.Snapshot.Name, r.Data.Name, sizeof(r.Snapshot.Name));
+    r.Snapshot.Address = r.Data.Address;
+    r.Snapshot.Handle = h;
+    r.Snapshot.Pin = r.Data.Pin;
+    r.Snapshot.Status = r.Data.Status;
+    r.Snapshot.Temperature = r.Data.Temperature;
+    r.Snapshot.LastRead = r.Data.LastRead;
+    r.Sequence.store(seq + 2, std::memory_order_release);
+}
+
+bool ThermometerPool::ReadSnapshot(ThermometerHandle h, ThermometerSnapshot &snapshot)
+{
+    if (h < 0 || h >= Count())
+    {
+        return false;
+    }
+    ThermometerRecord &r = records[h];
+    uint32_t seq;
+    do
+    {
+        seq = r.Sequence.load(std::memory_order_acquire);
+        memcpy(&snapshot, &r.Snapshot, sizeof(snapshot));
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((seq & 1) != 0 || seq != r.Sequence.load(std::memory_order_relaxed));
+    return true;
+}
+
+void ThermometerPool::AttachToBus(ThermometerHandle h, int8_t bus)
+{
+    ThermometerRecord &r = records[h];
+    if (r.Bus == bus)
+    {
+        return;
+    }
+    // the device was moved from another bus
+    if (r.Bus != NO_BUS)
+    {
+        ThermometerHandle prev = NO_THERMOMETER;
+        ThermometerHandle cur = firstOnBus[r.Bus];
+        while (cur != h)
+        {
+            prev = cur;
+            cur = records[cur].NextOnBus;
+        }
+        if (prev == NO_THERMOMETER)
+        {
+            firstOnBus[r.Bus] = r.NextOnBus;
+        }
+        else
+        {
+            records[prev].NextOnBus = r.NextOnBus;
+        }
+        if (lastOnBus[r.Bus] == h)
+        {
+            lastOnBus[r.Bus] = prev;
+        }
+    }
+    r.Bus = bus;
+    r.NextOnBus = NO_THERMOMETER;
+    if (lastOnBus[bus] == NO_THERMOMETER)
+    {
+        firstOnBus[bus] = h;
+    }
+    else
+    {
+        records[lastOnBus[bus]].NextOnBus = h;
+    }
+    lastOnBus[bus] = h;
+}
+
+uint32_t ThermometerPool::hashAddress(Address1Wire addr)
+{
+    // the serial number bytes are well distributed already
+    return (uint32_t)(addr.packedAddress >> 8) ^ (uint32_t)(addr.packedAddress >> 40);
+}
+
+uint32_t ThermometerPool::hashName(const char *name)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < LENGTH_OF_NAME - 1 && name[i] != 0; i++)
+    {
+        hash = (hash ^ (uint8_t)name[i]) * 16777619u;
+    }
+    return hash;
+}
+
+void ThermometerPool::linkName(ThermometerHandle h)
+{
+    uint32_t bucket = hashName(records[h].Data.Name) % MAX_THERMOMETERS;
+    records[h].NextByName = nameBuckets[bucket];
+    nameBuckets[bucket] = h;
+}
+
+void ThermometerPool::unlinkName(ThermometerHandle h)
+{
+    ThermometerHandle *link = &nameBuckets[hashName(records[h].Data.Name) % MAX_THERMOMETERS];
+    while (*link != h)
+    {
+        link = &records[*link].NextByName;
+    }
+    *link = records[h].NextByName;
+}
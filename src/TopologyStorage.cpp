@@ -0,0 +1,134 @@
+#include "TopologyStorage.hpp"
+
+bool TopologyStorageFile::Open(bool isWrite)
+{
+    Close();
+    isWriting = isWrite;
+    isFailed = false;
+    // a new set is written aside and replaces the current one on Close()
+    char name[128];
+    snprintf(name, sizeof(name), isWrite ? "%s.new" : "%s", path);
+    file = fopen(name, isWrite ? "wb" : "rb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+    FileHeader header = {TOPOLOGY_MAGIC, TOPOLOGY_VERSION, sizeof(TopologyRecord)};
+    if (isWrite)
+    {
+        isFailed = fwrite(&header, sizeof(header), 1, file) != 1;
+        return !isFailed;
+    }
+    FileHeader stored;
+    if (fread(&stored, sizeof(stored), 1, file) != 1 || memcmp(&stored, &header, sizeof(header)) != 0)
+    {
+        // unknown format: as if nothing was stored
+        Close();
+        return false;
+    }
+    return true;
+}
+
+bool TopologyStorageFile::Read(TopologyRecord &record)
+{
+    return file != nullptr && !isWriting && fread(&record, sizeof(record), 1, file) == 1;
+}
+
+bool TopologyStorageFile::Write(const TopologyRecord &record)
+{
+    if (file == nullptr || !isWriting || fwrite(&record, sizeof(record), 1, file) != 1)
+    {
+        isFailed = true;
+    }
+    return !isFailed;
+}
+
+bool TopologyStorageFile::Close()
+{
+    if (file == nullptr)
+    {
+        return false;
+    }
+    bool isDone = fclose(file) == 0 && !isFailed;
+    file = nullptr;
+    if (isWriting)
+    {
+        char name[128];
+        snprintf(name, sizeof(name), "%s.new", path);
+        isDone = isDone && rename(name, path) == 0;
+        isWriting = false;
+    }
+    return isDone;
+}
+
+#ifdef ARDUINO
+bool TopologyStorageNvs::Open(bool isWrite)
+{
+    Close();
+    isWriting = isWrite;
+    isFailed = false;
+    index = 0;
+    count = 0;
+    if (nvs_open(nvsNamespace, isWrite ? NVS_READWRITE : NVS_READONLY, &handle) != ESP_OK)
+    {
+        return false;
+    }
+    isOpen = true;
+    if (isWrite)
+    {
+        // the count is written last: a set cut by a reboot is not read
+        isFailed = nvs_set_u32(handle, "count", 0) != ESP_OK;
+        return !isFailed;
+    }
+    uint32_t version = 0;
+    if (nvs_get_u32(handle, "version", &version) != ESP_OK || version != TOPOLOGY_VERSION ||
+        nvs_get_u32(handle, "count", &count) != ESP_OK)
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+bool TopologyStorageNvs::Read(TopologyRecord &record)
+{
+    if (!isOpen || isWriting || index >= count)
+    {
+        return false;
+    }
+    char key[16];
+    snprintf(key, sizeof(key), "r%u", (unsigned)index++);
+    size_t size = sizeof(record);
+    return nvs_get_blob(handle, key, &record, &size) == ESP_OK && size == sizeof(record);
+}
+
+bool TopologyStorageNvs::Write(const TopologyRecord &record)
+{
+    char key[16];
+    snprintf(key, sizeof(key), "r%u", (unsigned)count);
+    if (!isOpen || !isWriting || nvs_set_blob(handle, key, &record, sizeof(record)) != ESP_OK)
+    {
+        isFailed = true;
+    }
+    count++;
+    return !isFailed;
+}
+
+bool TopologyStorageNvs::Close()
+{
+    if (!isOpen)
+    {
+        return false;
+    }
+    bool isDone = !isFailed;
+    if (isWriting)
+    {
+        isDone = isDone && nvs_set_u32(handle, "version", TOPOLOGY_VERSION) == ESP_OK &&
+                 nvs_set_u32(handle, "count", count) == ESP_OK && nvs_commit(handle) == ESP_OK;
+        isWriting = false;
+    }
+    nvs_close(handle);
+    isOpen = false;
+    return isDone;
+}
+#endif
@@ -0,0 +1,276 @@
+#ifndef ARDUINO
+#include "HostPlatform.h"
+#include <stdarg.h>
+#include <new>
+#include <vector>
+
+HostSerial Serial;
+
+static uint64_t hostClockUs = 0;
+static uint32_t hostPostedEvents = 0;
+static uint64_t hostLoopBusyUntilUs = 0;
+
+//------------------------------------------------------------------------------ Arduino core
+String::String(long long value, unsigned char base)
+{
+    char buf[2 + 8 * sizeof(long long)];
+    if (base == 16)
+    {
+        snprintf(buf, sizeof(buf), "%llx", (unsigned long long)value);
+    }
+    else
+    {
+        snprintf(buf, sizeof(buf), "%lld", value);
+    }
+    str = buf;
+}
+
+int HostSerial::printf(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int res = vprintf(format, args);
+    va_end(args);
+    return res;
+}
+
+unsigned long millis() { return (unsigned long)(hostClockUs / 1000); }
+unsigned long micros() { return (unsigned long)hostClockUs; }
+void delay(unsigned long ms) { hostClockUs += (uint64_t)ms * 1000; }
+void delayMicroseconds(unsigned int us) { hostClockUs += us; }
+void yield() {}
+int64_t esp_timer_get_time() { return (int64_t)hostClockUs; }
+
+//------------------------------------------------------------------------------ FreeRTOS timers
+struct HostTimer
+{
+    const char *Name;
+    TickType_t Period;
+    bool AutoReload;
+    bool Active;
+    void *Id;
+    TimerCallbackFunction_t Callback;
+    uint64_t ExpiresUs;
+};
+static_assert(sizeof(HostTimer) <= sizeof(StaticTimer_t), "StaticTimer_t is too small");
+
+// function static: timers are created by global constructors
+static std::vector<HostTimer *> &hostTimers()
+{
+    static std::vector<HostTimer *> timers;
+    return timers;
+}
+
+TimerHandle_t xTimerCreateStatic(const char *name, TickType_t period, UBaseType_t autoReload, void *timerId,
+                                 TimerCallbackFunction_t callback, StaticTimer_t *buffer)
+{
+    HostTimer *timer = new (buffer) HostTimer();
+    timer->Name = name;
+    timer->Period = period;
+    timer->AutoReload = autoReload != pdFALSE;
+    timer->Active = false;
+    timer->Id = timerId;
+    timer->Callback = callback;
+    timer->ExpiresUs = 0;
+    hostTimers().push_back(timer);
+    return timer;
+}
+
+BaseType_t xTimerStart(TimerHandle_t timer, TickType_t ticksToWait)
+{
+    timer->Active = true;
+    timer->ExpiresUs = hostClockUs + (uint64_t)timer->Period * 1000;
+    return pdPASS;
+}
+
+BaseType_t xTimerStop(TimerHandle_t timer, TickType_t ticksToWait)
+{
+    timer->Active = false;
+    return pdPASS;
+}
+
+BaseType_t xTimerReset(TimerHandle_t timer, TickType_t ticksToWait)
+{
+    return xTimerStart(timer, ticksToWait);
+}
+
+BaseType_t xTimerChangePeriod(TimerHandle_t timer, TickType_t period, TickType_t ticksToWait)
+{
+    timer->Period = period;
+    return xTimerStart(timer, ticksToWait);
+}
+
+BaseType_t xTimerDelete(TimerHandle_t timer, TickType_t ticksToWait)
+{
+    std::vector<HostTimer *> &timers = hostTimers();
+    for (size_t i = 0; i < timers.size(); i++)
+    {
+        if (timers[i] == timer)
+        {
+            timers.erase(timers.begin() + i);
+            break;
+        }
+    }
+    return pdPASS;
+}
+
+BaseType_t xTimerIsTimerActive(TimerHandle_t timer)
+{
+    return timer->Active ? pdTRUE : pdFALSE;
+}
+
+void *pvTimerGetTimerID(TimerHandle_t timer)
+{
+    return timer->Id;
+}
+
+//------------------------------------------------------------------------------ ESP-IDF events
+// Events are dispatched synchronously to the registered handlers.
+typedef struct
+{
+    esp_event_loop_handle_t Loop;
+    esp_event_base_t Base;
+    int32_t Id;
+    esp_event_handler_t Handler;
+    void *Arg;
+} HostHandler;
+
+static std::vector<HostHandler> hostHandlers;
+
+esp_err_t esp_event_loop_create_default()
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_event_loop_create(const esp_event_loop_args_t *event_loop_args, esp_event_loop_handle_t *event_loop)
+{
+    // the handle only tells the loops apart: the handlers are called by the poster
+    static uintptr_t loops = 0;
+    *event_loop = (esp_event_loop_handle_t)++loops;
+    return ESP_OK;
+}
+
+esp_err_t esp_event_post_to(esp_event_loop_handle_t event_loop, esp_event_base_t event_base, int32_t event_id,
+                            const void *event_data, size_t event_data_size, TickType_t ticks_to_wait)
+{
+    if (hostClockUs < hostLoopBusyUntilUs)
+    {
+        // the queue of the loop is full: the poster waits for the handlers
+        uint64_t wait = hostLoopBusyUntilUs - hostClockUs;
+        if (ticks_to_wait != portMAX_DELAY && (uint64_t)ticks_to_wait * portTICK_PERIOD_MS * 1000 < wait)
+        {
+            hostClockUs += (uint64_t)ticks_to_wait * portTICK_PERIOD_MS * 1000;
+            return ESP_ERR_TIMEOUT;
+        }
+        hostClockUs = hostLoopBusyUntilUs;
+    }
+    // the loop copies event_data_size bytes, as ESP-IDF does: the rest of the copy is garbage for the handlers
+    alignas(8) uint8_t data[HOST_EVENT_DATA_SIZE];
+    if (event_data_size > sizeof(data))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(data, 0xA5, sizeof(data));
+    if (event_data != nullptr)
+    {
+        memcpy(data, event_data, event_data_size);
+    }
+    hostPostedEvents++;
+    for (size_t i = 0; i < hostHandlers.size(); i++)
+    {
+        HostHandler &h = hostHandlers[i];
+        if (h.Loop == event_loop && (h.Base == event_base || strcmp(h.Base, event_base) == 0) &&
+            (h.Id == ESP_EVENT_ANY_ID || h.Id == event_id))
+        {
+            h.Handler(h.Arg, event_base, event_id, event_data != nullptr ? data : nullptr);
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_event_post(esp_event_base_t event_base, int32_t event_id, const void *event_data, size_t event_data_size,
+                         TickType_t ticks_to_wait)
+{
+    return esp_event_post_to(nullptr, event_base, event_id, event_data, event_data_size, ticks_to_wait);
+}
+
+esp_err_t esp_event_handler_instance_register_with(esp_event_loop_handle_t event_loop, esp_event_base_t event_base,
+                                                   int32_t event_id, esp_event_handler_t event_handler,
+                                                   void *event_handler_arg, esp_event_handler_instance_t *instance)
+{
+    HostHandler h = {event_loop, event_base, event_id, event_handler, event_handler_arg};
+    hostHandlers.push_back(h);
+    if (instance != nullptr)
+    {
+        *instance = (void *)(hostHandlers.size());
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_instance_register(esp_event_base_t event_base, int32_t event_id,
+                                              esp_event_handler_t event_handler, void *event_handler_arg,
+                                              esp_event_handler_instance_t *instance)
+{
+    return esp_event_handler_instance_register_with(nullptr, event_base, event_id, event_handler, event_handler_arg,
+                                                    instance);
+}
+
+//------------------------------------------------------------------------------ Host control
+uint64_t HostPlatform::NowMicros()
+{
+    return hostClockUs;
+}
+
+void HostPlatform::Advance(uint64_t us)
+{
+    hostClockUs += us;
+}
+
+void HostPlatform::RunFor(unsigned long ms)
+{
+    uint64_t until = hostClockUs + (uint64_t)ms * 1000;
+    for (;;)
+    {
+        HostTimer *next = nullptr;
+        for (size_t i = 0; i < hostTimers().size(); i++)
+        {
+            HostTimer *t = hostTimers()[i];
+            if (t->Active && (next == nullptr || t->ExpiresUs < next->ExpiresUs))
+            {
+                next = t;
+            }
+        }
+        if (next == nullptr || next->ExpiresUs > until)
+        {
+            break;
+        }
+        if (next->ExpiresUs > hostClockUs)
+        {
+            hostClockUs = next->ExpiresUs;
+        }
+        if (next->AutoReload)
+        {
+            next->ExpiresUs += (uint64_t)next->Period * 1000;
+        }
+        else
+        {
+            next->Active = false;
+        }
+        next->Callback(next);
+    }
+    if (hostClockUs < until)
+    {
+        hostClockUs = until;
+    }
+}
+
+uint32_t HostPlatform::PostedEvents()
+{
+    return hostPostedEvents;
+}
+
+void HostPlatform::StallEventLoop(unsigned long ms)
+{
+    hostLoopBusyUntilUs = hostClockUs + (uint64_t)ms * 1000;
+}
+#endif